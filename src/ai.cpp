@@ -5,6 +5,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include "os/math.h"
 
 #include "ai.h"
@@ -14,6 +15,7 @@
 #include "tile.h"
 #include "enhancement.h"
 #include "map.h"
+#include "opendune.h"
 
 #include "pool/housepool.h"
 #include "pool/pool.h"
@@ -65,6 +67,11 @@ enum AISquadState
 
 ENUM_MATH_OPERATORS(AISquadState)
 
+enum
+{
+	AISQUAD_MEMBERS_MAX = 8
+};
+
 struct AISquad
 {
 	SquadID aiSquad;
@@ -78,6 +85,9 @@ struct AISquad
 
 	int64_t recruitment_timeout;
 	int64_t formation_timeout;
+
+	/* Not saved; rebuilt from the units by UnitAI_RecountSquads. */
+	uint16 member[AISQUAD_MEMBERS_MAX]; /* Unit index of each member. */
 };
 
 struct AISquadPlan
@@ -368,6 +378,10 @@ uint16 StructureAI_PickNextToBuild(const Structure* s)
 			if ((buildable & (1 << type)) == 0)
 				continue;
 
+			/* ENHANCEMENT -- The brutal AI does not start on a structure whose spot is taken, as it would be refunded when done. */
+			if (AI_IsBrutalAI((HouseType)s->o.houseID) && !Structure_IsBuildable(h->ai_structureRebuild[i][1], (StructureType)type))
+				continue;
+
 			return type;
 		}
 
@@ -569,6 +583,86 @@ void UnitAI_ClearSquads()
 		s_aisquad[aiSquad].num_members = 0;
 }
 
+/**
+ * Members that are carried around or deviated do not take part in the squad's orders.
+ */
+static bool UnitAI_SquadIsActive(const AISquad* squad, const Unit* u)
+{
+	if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+		return false;
+
+	return (Unit_GetHouseID(u) == squad->houseID);
+}
+
+static bool UnitAI_SquadIsNear(const Unit* u, uint16 packed)
+{
+	int dist = Tile_GetDistanceRoundedUp(u->o.position, Tile_UnpackTile(packed));
+	int proximity = max(8, g_table_unitInfo[u->o.type].fireDistance + 2);
+
+	/* AI units on ACTION_HUNT don't usually get closer than their
+	 * fire distance.
+	 */
+	return (dist < proximity);
+}
+
+static void UnitAI_SquadAddMember(AISquad* squad, Unit* unit)
+{
+	const int i = squad->num_members;
+
+	assert(i < AISQUAD_MEMBERS_MAX);
+
+	unit->aiSquad = squad->aiSquad;
+	squad->member[i] = unit->o.index;
+	squad->num_members++;
+}
+
+static void UnitAI_SquadRemoveMember(AISquad* squad, Unit* unit)
+{
+	for (int i = 0; i < squad->num_members; i++)
+	{
+		if (squad->member[i] != unit->o.index)
+			continue;
+
+		/* Keep the order in which members joined. */
+		squad->num_members--;
+		memmove(&squad->member[i], &squad->member[i + 1], (squad->num_members - i) * sizeof(squad->member[0]));
+		break;
+	}
+
+	unit->aiSquad = SQUADID_INVALID;
+}
+
+/**
+ * Rebuild the member lists of all squads from the units, after loading.
+ */
+void UnitAI_RecountSquads()
+{
+	PoolFindStruct find;
+
+	for (int aiSquad = SQUADID_1; aiSquad <= SQUADID_MAX; aiSquad++)
+		s_aisquad[aiSquad].num_members = 0;
+
+	find.houseID = HOUSE_INVALID;
+	find.type = 0xFFFF;
+	find.index = 0xFFFF;
+
+	Unit* u = Unit_Find(&find);
+	while (u != NULL)
+	{
+		if (u->aiSquad != SQUADID_INVALID)
+		{
+			AISquad* squad = &s_aisquad[u->aiSquad];
+
+			if (squad->num_members < AISQUAD_MEMBERS_MAX)
+				UnitAI_SquadAddMember(squad, u);
+			else
+				u->aiSquad = SQUADID_INVALID;
+		}
+
+		u = Unit_Find(&find);
+	}
+}
+
 static void UnitAI_ClampWaypoint(int* x, int* y)
 {
 	const MapInfo* mapInfo = &g_mapInfos[g_scenario.mapScale];
@@ -628,21 +722,6 @@ static void UnitAI_SquadPlotWaypoints(AISquad* squad, Unit* unit, uint16 target_
 	squad->target = target_encoded;
 }
 
-static Unit* UnitAI_SquadFind(const AISquad* squad, PoolFindStruct* find)
-{
-	Unit* u = Unit_Find(find);
-
-	while (u != NULL)
-	{
-		if (u->aiSquad == squad->aiSquad)
-			return u;
-
-		u = Unit_Find(find);
-	}
-
-	return NULL;
-}
-
 static void UnitAI_AssignSquad(Unit* unit, uint16 destination)
 {
 	SquadID emptySquadID = SQUADID_INVALID;
@@ -688,8 +767,7 @@ static void UnitAI_AssignSquad(Unit* unit, uint16 destination)
 		if (distance > 16)
 			continue;
 
-		unit->aiSquad = (SquadID)aiSquad;
-		squad->num_members++;
+		UnitAI_SquadAddMember(squad, unit);
 
 		if (squad->num_members >= squad->max_members)
 			squad->state++;
@@ -710,13 +788,12 @@ static void UnitAI_AssignSquad(Unit* unit, uint16 destination)
 	{
 		AISquad* squad = &s_aisquad[emptySquadID];
 
-		unit->aiSquad = emptySquadID;
-
 		squad->aiSquad = emptySquadID;
 		squad->state = AISQUAD_RECRUITING;
 		squad->houseID = (HouseType)unit->o.houseID;
-		squad->num_members = 1;
+		squad->num_members = 0;
 		squad->max_members = 3;
+		UnitAI_SquadAddMember(squad, unit);
 
 		/* 60 ticks per second, distance is roughly 30. */
 		squad->recruitment_timeout = g_timerGame + Tools_AdjustToGameSpeed(120 * (distance - 12), 1, 0xFFFF, true);
@@ -726,19 +803,15 @@ static void UnitAI_AssignSquad(Unit* unit, uint16 destination)
 
 static void UnitAI_SquadCharge(AISquad* squad)
 {
-	PoolFindStruct find;
+	for (int i = 0; i < squad->num_members; i++)
+	{
+		Unit* u = Unit_Get_ByIndex(squad->member[i]);
 
-	find.houseID = squad->houseID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
+		if (!UnitAI_SquadIsActive(squad, u))
+			continue;
 
-	Unit* u = UnitAI_SquadFind(squad, &find);
-	while (u != NULL)
-	{
 		Unit_SetAction(u, ACTION_HUNT);
 		u->targetAttack = squad->target;
-
-		u = UnitAI_SquadFind(squad, &find);
 	}
 }
 
@@ -750,25 +823,19 @@ void UnitAI_DetachFromSquad(Unit* unit)
 	if (unit->actionID != ACTION_HUNT)
 		Unit_SetAction(unit, ACTION_HUNT);
 
-	unit->aiSquad = SQUADID_INVALID;
-	s_aisquad[unit->aiSquad].num_members--;
+	UnitAI_SquadRemoveMember(&s_aisquad[unit->aiSquad], unit);
 }
 
 static void UnitAI_DisbandSquad(AISquad* squad)
 {
-	PoolFindStruct find;
-
-	find.houseID = squad->houseID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-
-	Unit* u = UnitAI_SquadFind(squad, &find);
-	while (u != NULL)
+	for (int i = 0; i < squad->num_members; i++)
 	{
+		Unit* u = Unit_Get_ByIndex(squad->member[i]);
+
 		u->aiSquad = SQUADID_INVALID;
-		Unit_SetTarget(u, squad->target);
 
-		u = UnitAI_SquadFind(squad, &find);
+		if (UnitAI_SquadIsActive(squad, u))
+			Unit_SetTarget(u, squad->target);
 	}
 
 	squad->num_members = 0;
@@ -814,24 +881,37 @@ uint16 UnitAI_GetSquadDestination(Unit* unit, uint16 destination)
 	}
 }
 
-static bool UnitAI_SquadIsInFormation(const AISquad* squad)
+/**
+ * Check if a unit is heading to the destination shared by its squad,
+ *  rather than to a formation position of its own.
+ */
+bool UnitAI_IsSquadDestination(const Unit* unit, uint16 packed)
 {
-	PoolFindStruct find;
+	if (unit->aiSquad == SQUADID_INVALID)
+		return false;
+
+	const AISquad* squad = &s_aisquad[unit->aiSquad];
 
+	if (squad->state <= AISQUAD_DETOUR3)
+		return (packed == squad->waypoint[squad->state]);
+
+	if (squad->state == AISQUAD_CHARGE)
+		return (packed == Tools_Index_GetPackedTile(squad->target));
+
+	return false;
+}
+
+static bool UnitAI_SquadIsInFormation(const AISquad* squad)
+{
 	if (g_timerGame > squad->formation_timeout)
 		return true;
 
-	find.houseID = squad->houseID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-
-	Unit* u = UnitAI_SquadFind(squad, &find);
-	while (u != NULL)
+	for (int i = 0; i < squad->num_members; i++)
 	{
-		if (u->targetMove != 0)
-			return false;
+		const Unit* u = Unit_Get_ByIndex(squad->member[i]);
 
-		u = UnitAI_SquadFind(squad, &find);
+		if (UnitAI_SquadIsActive(squad, u) && u->targetMove != 0)
+			return false;
 	}
 
 	return true;
@@ -839,15 +919,14 @@ static bool UnitAI_SquadIsInFormation(const AISquad* squad)
 
 static bool UnitAI_SquadIsGathered(const AISquad* squad)
 {
-	PoolFindStruct find;
-	tile32 destination;
+	uint16 packed;
 
 	if (squad->state >= AISQUAD_DISBAND)
 		return true;
 
 	if (squad->state <= AISQUAD_DETOUR3)
 	{
-		destination = Tile_UnpackTile(squad->waypoint[squad->state]);
+		packed = squad->waypoint[squad->state];
 	}
 	else if (squad->state == AISQUAD_BATTLE_FORMATION)
 	{
@@ -855,32 +934,18 @@ static bool UnitAI_SquadIsGathered(const AISquad* squad)
 	}
 	else
 	{
-		uint16 packed = Tools_Index_GetPackedTile(squad->target);
+		packed = Tools_Index_GetPackedTile(squad->target);
 		if (packed == 0)
 			return true;
-
-		destination = Tile_UnpackTile(packed);
 	}
 
-	find.houseID = squad->houseID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-
-	Unit* u = UnitAI_SquadFind(squad, &find);
-	while (u != NULL)
+	/* Members that are not taking part do not need to be near. */
+	for (int i = 0; i < squad->num_members; i++)
 	{
-		int dist = Tile_GetDistanceRoundedUp(u->o.position, destination);
-		int proximity = max(8, g_table_unitInfo[u->o.type].fireDistance + 2);
+		const Unit* u = Unit_Get_ByIndex(squad->member[i]);
 
-		/* AI units on ACTION_HUNT don't usually get closer than their
-		 * fire distance.
-		 */
-		if (dist >= proximity)
-		{
+		if (UnitAI_SquadIsActive(squad, u) && !UnitAI_SquadIsNear(u, packed))
 			return false;
-		}
-
-		u = UnitAI_SquadFind(squad, &find);
 	}
 
 	return true;
@@ -915,15 +980,13 @@ static void UnitAI_ArrangeBattleFormation(AISquad* squad)
 	int ux = targetx + distance * dx[orient8];
 	int uy = targety + distance * dy[orient8];
 
-	PoolFindStruct find;
+	for (int i = 0; i < squad->num_members; i++)
+	{
+		Unit* u = Unit_Get_ByIndex(squad->member[i]);
 
-	find.houseID = squad->houseID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
+		if (!UnitAI_SquadIsActive(squad, u))
+			continue;
 
-	Unit* u = UnitAI_SquadFind(squad, &find);
-	while (u != NULL)
-	{
 		u->targetMove = Tools_Index_Encode(Tile_PackXY(ux, uy), IT_TILE);
 
 		/* We need the destination to be precise! */
@@ -935,7 +998,6 @@ static void UnitAI_ArrangeBattleFormation(AISquad* squad)
 
 		rank++;
 		sign = -sign;
-		u = UnitAI_SquadFind(squad, &find);
 	}
 
 	/* Time to build formation, 60 ticks per second. */
@@ -15,9 +15,11 @@ uint16 UnitAI_GetAnyEnemyInRange(const Unit* unit);
 bool UnitAI_ShouldDestructDevastator(const Unit* devastator);
 
 void UnitAI_ClearSquads();
+void UnitAI_RecountSquads();
 void UnitAI_DetachFromSquad(Unit* unit);
 void UnitAI_AbortMission(Unit* unit, uint16 enemy);
 uint16 UnitAI_GetSquadDestination(Unit* unit, uint16 destination);
+bool UnitAI_IsSquadDestination(const Unit* unit, uint16 packed);
 void UnitAI_SquadLoop();
 
 bool BrutalAI_Load(FILE* fp, uint32 length);
@@ -2,23 +2,25 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include "types.h"
+#include "os/common.h"
 
 #include "animation.h"
 
 #include "audio/audio.h"
-#include "binheap.h"
 #include "map.h"
 #include "sprites.h"
 #include "structure.h"
 #include "timer/timer.h"
+#include "timerwheel.h"
 #include "tools/coord.h"
 #include "tools/random_general.h"
 
 typedef struct Animation
 {
-	/* Heap key. */
 	int64_t tickNext; /*!< Which tick this Animation should be called again. */
+	int handle; /*!< Handle of the Animation in #s_animations. */
 
 	StructureLayout tileLayout; /*!< Tile layout of the Animation. */
 	HouseType houseID; /*!< House of the item being animated. */
@@ -28,7 +30,52 @@ typedef struct Animation
 	tile32 tile; /*!< Top-left tile of Animation. */
 } Animation;
 
-static BinHeap s_animations;
+/**
+ * An Animation as saved by Animation_Save.
+ */
+typedef struct AnimationSave
+{
+	int64_t tickNext; /*!< Which tick this Animation should be called again. */
+	tile32 tile; /*!< Top-left tile of Animation. */
+	int16 table; /*!< Index of the commands table in #s_animationTables; -1 for none. */
+	uint16 offset; /*!< Index of the first command in that table. */
+	uint8 tileLayout; /*!< Tile layout of the Animation. */
+	uint8 houseID; /*!< House of the item being animated. */
+	uint8 current; /*!< At which command we currently are in the Animation. */
+	uint8 iconGroup; /*!< Which iconGroup the sprites of the Animation belongs. */
+	uint8 isOnTile; /*!< Is it the Animation found for its tile. */
+} AnimationSave;
+
+static TimerWheel s_animations;
+static int s_animationByTile[MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Animation on each (top-left) tile. */
+
+/** Tables the commands of an Animation come from, with their length in commands. */
+static const struct {
+	const AnimationCommandStruct* commands;
+	uint16 count;
+} s_animationTables[] = {
+	{ g_table_animation_unitMove[0],    sizeof(g_table_animation_unitMove)    / sizeof(AnimationCommandStruct) },
+	{ g_table_animation_unitScript1[0], sizeof(g_table_animation_unitScript1) / sizeof(AnimationCommandStruct) },
+	{ g_table_animation_unitScript2[0], sizeof(g_table_animation_unitScript2) / sizeof(AnimationCommandStruct) },
+	{ g_table_animation_map[0],         sizeof(g_table_animation_map)         / sizeof(AnimationCommandStruct) },
+	{ g_table_animation_structure[0],   sizeof(g_table_animation_structure)   / sizeof(AnimationCommandStruct) },
+};
+
+/**
+ * Detach an Animation from its tile after it stopped.
+ * @param animation The Animation that stopped.
+ */
+static void Animation_Release(Animation* animation)
+{
+	const uint16 packed = Tile_PackTile(animation->tile);
+
+	if (s_animationByTile[packed] == animation->handle)
+		s_animationByTile[packed] = TIMERWHEEL_INVALID;
+
+	/* A running Animation is released by Animation_Tick once it returns. */
+	if (TimerWheel_IsScheduled(&s_animations, animation->handle))
+		TimerWheel_Release(&s_animations, animation->handle);
+}
 
 /**
  * Stop with this Animation.
@@ -53,6 +100,9 @@ static void Animation_Func_Stop(Animation* animation, int16 parameter)
 		if (animation->tileLayout != 0)
 		{
 			t->groundSpriteID = g_mapSpriteID[position];
+			if (!t->hasStructure)
+				g_mapRevision++;
+			Structure_InvalidateBuildIndex(position);
 		}
 
 		if (Map_IsPositionUnveiled(position))
@@ -62,6 +112,8 @@ static void Animation_Func_Stop(Animation* animation, int16 parameter)
 
 		Map_Update(position, 0, false);
 	}
+
+	Animation_Release(animation);
 }
 
 /**
@@ -78,6 +130,8 @@ static void Animation_Func_Abort(Animation* animation, int16 parameter)
 	animation->commands = NULL;
 
 	Map_Update(packed, 0, false);
+
+	Animation_Release(animation);
 }
 
 /**
@@ -90,7 +144,7 @@ static void Animation_Func_Pause(Animation* animation, int16 parameter)
 {
 	assert(parameter >= 0);
 
-	animation->tickNext = Timer_GetTicks() + parameter + (Tools_Random_256() % 4);
+	animation->tickNext = g_timerGame + parameter + (Tools_Random_256() % 4);
 }
 
 /**
@@ -109,6 +163,7 @@ static void Animation_Func_SetOverlaySprite(Animation* animation, int16 paramete
 	Tile* t = &g_map[packed];
 	t->overlaySpriteID = g_iconMap[g_iconMap[animation->iconGroup] + parameter];
 	t->houseID = animation->houseID;
+	Structure_InvalidateBuildIndex(packed);
 
 	Map_Update(packed, 0, false);
 }
@@ -165,6 +220,11 @@ static void Animation_Func_SetGroundSprite(Animation* animation, int16 parameter
 		t->groundSpriteID = spriteID;
 		t->houseID = animation->houseID;
 
+		/* Tiles of a structure are impassable whatever their sprite */
+		if (!t->hasStructure)
+			g_mapRevision++;
+		Structure_InvalidateBuildIndex(position);
+
 		if (Map_IsPositionUnveiled(position))
 		{
 			t->overlaySpriteID = 0;
@@ -209,12 +269,15 @@ static void Animation_Func_PlayVoice(Animation* animation, int16 parameter)
 
 void Animation_Init()
 {
-	BinHeap_Init(&s_animations, sizeof(Animation));
+	TimerWheel_Init(&s_animations, sizeof(Animation), g_timerGame);
+
+	/* All bits set is TIMERWHEEL_INVALID. */
+	memset(s_animationByTile, 0xFF, sizeof(s_animationByTile));
 }
 
 void Animation_Uninit()
 {
-	BinHeap_Free(&s_animations);
+	TimerWheel_Free(&s_animations);
 }
 
 /**
@@ -230,9 +293,13 @@ void Animation_Start(const AnimationCommandStruct* commands, tile32 tile, uint16
 	uint16 packed = Tile_PackTile(tile);
 	Animation_Stop_ByTile(packed);
 
-	Animation* animation = (Animation *)BinHeap_Push(&s_animations, Timer_GetTicks());
-	if (animation != NULL)
+	const int handle = TimerWheel_Alloc(&s_animations);
+	if (handle != TIMERWHEEL_INVALID)
 	{
+		Animation* animation = (Animation *)TimerWheel_Get(&s_animations, handle);
+
+		animation->tickNext = g_timerGame;
+		animation->handle = handle;
 		animation->tileLayout = (StructureLayout)tileLayout;
 		animation->houseID = (HouseType)houseID;
 		animation->current = 0;
@@ -242,6 +309,10 @@ void Animation_Start(const AnimationCommandStruct* commands, tile32 tile, uint16
 
 		g_map[packed].houseID = houseID;
 		g_map[packed].hasAnimation = true;
+		Structure_InvalidateBuildIndex(packed);
+
+		s_animationByTile[packed] = handle;
+		TimerWheel_Schedule(&s_animations, handle, animation->tickNext);
 	}
 }
 
@@ -254,18 +325,14 @@ void Animation_Stop_ByTile(uint16 packed)
 	if (!g_map[packed].hasAnimation)
 		return;
 
-	for (int i = 1; i < s_animations.num_elem; i++)
-	{
-		Animation* animation = (Animation *)BinHeap_GetElem(&s_animations, i);
+	if (s_animationByTile[packed] == TIMERWHEEL_INVALID)
+		return;
 
-		if (animation->commands == NULL)
-			continue;
-		if (Tile_PackTile(animation->tile) != packed)
-			continue;
+	Animation* animation = (Animation *)TimerWheel_Get(&s_animations, s_animationByTile[packed]);
+	if (animation->commands == NULL)
+		return;
 
-		Animation_Func_Stop(animation, 0);
-		break;
-	}
+	Animation_Func_Stop(animation, 0);
 }
 
 /**
@@ -273,11 +340,13 @@ void Animation_Stop_ByTile(uint16 packed)
  */
 void Animation_Tick()
 {
-	const int64_t curr_ticks = Timer_GetTicks();
+	const int64_t curr_ticks = g_timerGame;
 
-	Animation* animation = (Animation *)BinHeap_GetMin(&s_animations);
-	while ((animation != NULL) && (animation->tickNext <= curr_ticks))
+	int handle;
+	while ((handle = TimerWheel_PopDue(&s_animations, curr_ticks)) != TIMERWHEEL_INVALID)
 	{
+		Animation* animation = (Animation *)TimerWheel_Get(&s_animations, handle);
+
 		while (animation->commands != NULL)
 		{
 			const AnimationCommandStruct* commands = animation->commands + animation->current;
@@ -316,13 +385,100 @@ void Animation_Tick()
 
 		if (animation->commands == NULL)
 		{
-			BinHeap_Pop(&s_animations);
+			/* Animations started without commands never went through Animation_Release. */
+			const uint16 packed = Tile_PackTile(animation->tile);
+			if (s_animationByTile[packed] == handle)
+				s_animationByTile[packed] = TIMERWHEEL_INVALID;
+
+			TimerWheel_Release(&s_animations, handle);
 		}
 		else
 		{
-			BinHeap_UpdateMin(&s_animations);
+			TimerWheel_Schedule(&s_animations, handle, animation->tickNext);
 		}
+	}
+}
+
+static bool Animation_SaveOne(FILE* fp, void* elem)
+{
+	const Animation* animation = (const Animation *)elem;
+	AnimationSave as;
+
+	memset(&as, 0, sizeof(as));
+	as.tickNext = animation->tickNext;
+	as.tile = animation->tile;
+	as.table = -1;
+	as.tileLayout = animation->tileLayout;
+	as.houseID = animation->houseID;
+	as.current = animation->current;
+	as.iconGroup = animation->iconGroup;
+	as.isOnTile = (s_animationByTile[Tile_PackTile(animation->tile)] == animation->handle) ? 1 : 0;
+
+	for (unsigned int i = 0; i < lengthof(s_animationTables) && animation->commands != NULL; i++)
+	{
+		const AnimationCommandStruct* start = s_animationTables[i].commands;
+		if (animation->commands < start || animation->commands >= start + s_animationTables[i].count)
+			continue;
 
-		animation = (Animation *)BinHeap_GetMin(&s_animations);
+		as.table = i;
+		as.offset = (uint16)(animation->commands - start);
+		break;
 	}
+
+	return fwrite(&as, sizeof(as), 1, fp) == 1;
+}
+
+static bool Animation_LoadOne(FILE* fp, void* elem, int handle)
+{
+	Animation* animation = (Animation *)elem;
+	AnimationSave as;
+
+	if (fread(&as, sizeof(as), 1, fp) != 1)
+		return false;
+	if (as.table >= (int)lengthof(s_animationTables))
+		return false;
+	if (as.table >= 0 && as.offset >= s_animationTables[as.table].count)
+		return false;
+
+	animation->tickNext = as.tickNext;
+	animation->handle = handle;
+	animation->tileLayout = (StructureLayout)as.tileLayout;
+	animation->houseID = (HouseType)as.houseID;
+	animation->current = as.current;
+	animation->iconGroup = as.iconGroup;
+	animation->commands = (as.table < 0) ? NULL : s_animationTables[as.table].commands + as.offset;
+	animation->tile = as.tile;
+
+	if (as.isOnTile)
+		s_animationByTile[Tile_PackTile(animation->tile)] = handle;
+	return true;
+}
+
+/**
+ * Save the running Animations, in the order they are run in.
+ * @param fp The file to save to.
+ * @return True if and only if all bytes were written successful.
+ */
+bool Animation_Save(FILE* fp)
+{
+	return TimerWheel_Save(&s_animations, fp, &Animation_SaveOne);
+}
+
+/**
+ * Replace the running Animations with those saved by Animation_Save. The
+ *  game tick has to be the one they were saved at.
+ * @param fp The file to load from.
+ * @return True if and only if all bytes were read successful.
+ */
+bool Animation_Load(FILE* fp)
+{
+	memset(s_animationByTile, 0xFF, sizeof(s_animationByTile));
+
+	if (!TimerWheel_Load(&s_animations, sizeof(Animation), fp, &Animation_LoadOne))
+	{
+		Animation_Init();
+		return false;
+	}
+
+	return true;
 }
@@ -3,6 +3,8 @@
 #ifndef ANIMATE_H
 #define ANIMATE_H
 
+#include <stdio.h>
+
 /**
  * The valid types for command in AnimationCommandStruct.
  */
@@ -39,5 +41,7 @@ void Animation_Uninit();
 void Animation_Start(const AnimationCommandStruct* commands, tile32 tile, uint16 tileLayout, uint8 houseID, uint8 iconGroup);
 void Animation_Stop_ByTile(uint16 packed);
 void Animation_Tick();
+bool Animation_Save(FILE* fp);
+bool Animation_Load(FILE* fp);
 
 #endif /* ANIMATE_H */
@@ -35,6 +35,10 @@ float sound_volume = 0.65f;
 float voice_volume = 1.0f;
 
 bool g_opl_mame = true;
+bool g_music_cache = false;
+
+/* Distance in tiles outside the viewport beyond which sounds are not played. */
+#define AUDIO_CULL_DISTANCE 24
 
 static MusicInfo* curr_music;
 char music_message[128];
@@ -300,6 +304,10 @@ void Audio_PlaySample(SampleID sampleID, int volume, float pan)
 		s_sample_last_played[sampleID] = curr_ticks;
 		AudioA5_PlaySample(sampleID, (float)volume / 255.0f, pan);
 	}
+	else
+	{
+		AudioA5_MergeSample(sampleID, (float)volume / 255.0f, pan);
+	}
 }
 
 void Audio_PlaySoundAtTile(SoundID soundID, tile32 position)
@@ -322,11 +330,19 @@ void Audio_PlaySoundAtTile(SoundID soundID, tile32 position)
 	if (position.x != 0 && position.y != 0)
 	{
 		const WidgetInfo* wi = &g_table_gameWidgetInfo[GAME_WIDGET_VIEWPORT];
-		const int cx = Tile_GetPackedX(g_viewportPosition) + wi->width / (2 * TILE_SIZE);
-		const int cy = Tile_GetPackedY(g_viewportPosition) + wi->height / (2 * TILE_SIZE);
-		const uint16 packed = Tile_PackXY(cx, cy);
-
+		const int vx = Tile_GetPackedX(g_viewportPosition);
+		const int vy = Tile_GetPackedY(g_viewportPosition);
 		const int ux = Tile_GetPosX(position);
+		const int uy = Tile_GetPosY(position);
+
+		/* Drop sounds far away from the viewport before they take up an instance. */
+		if (ux < vx - AUDIO_CULL_DISTANCE || ux >= vx + wi->width / TILE_SIZE + AUDIO_CULL_DISTANCE ||
+				uy < vy - AUDIO_CULL_DISTANCE || uy >= vy + wi->height / TILE_SIZE + AUDIO_CULL_DISTANCE)
+			return;
+
+		const int cx = vx + wi->width / (2 * TILE_SIZE);
+		const int cy = vy + wi->height / (2 * TILE_SIZE);
+		const uint16 packed = Tile_PackXY(cx, cy);
 
 		volume = Tile_GetDistancePacked(packed, Tile_PackTile(position));
 		if (volume > 64)
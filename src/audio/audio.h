@@ -13,6 +13,7 @@ extern float sound_volume;
 extern float voice_volume;
 
 extern bool g_opl_mame;
+extern bool g_music_cache;
 extern char sound_font_path[1024];
 extern char music_message[128];
 
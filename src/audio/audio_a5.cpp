@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_acodec.h>
 #include <allegro5/allegro_audio.h>
@@ -13,6 +15,7 @@
 #include "audio.h"
 #include "../common_a5.h"
 #include "../file.h"
+#include "../os/math.h"
 #include "../table/sound.h"
 
 /* Sample instance 0 for narrator voices.
@@ -20,28 +23,120 @@
  * Other instances for general battle sounds.
  */
 #define MAX_SAMPLE_INSTANCES 12
+#define SAMPLE_INSTANCE_BATTLE 2
+
+/* Which sample each instance plays, and when it will be done.
+ * Knowing the end time means finding a free instance does not need to
+ * lock the mixer for every instance probed.
+ */
+typedef struct SampleVoice
+{
+	SampleID sampleID;
+	int priority; /*!< Battle sounds of lower priority may be cut off. */
+	float gain;
+	double end; /*!< al_get_time() when the sample finishes. */
+} SampleVoice;
 
 /* Music configuration. */
 static const int SRATE = 44100;
 static const int NUMFRAGS = 4;
 static const int FRAGLEN = 2048;
 
+/* Tracks longer than this are not cached. Looping tracks are noticed well before. */
+static const int MUSIC_CACHE_MAX_LENGTH = 10 * 60 * SRATE;
+
+/* A track being recorded into the music cache, as it is played. */
+typedef struct MusicCacheJob
+{
+	bool recording;
+	int16* buf;
+	int length; /*!< Samples recorded so far. */
+	int capacity;
+	char filename[1024];
+} MusicCacheJob;
+
 static ALLEGRO_AUDIO_STREAM* s_music_stream;
 static ALLEGRO_AUDIO_STREAM* s_effect_stream;
 static SoundAdLibPC* s_adlib;
 static ALLEGRO_THREAD* s_music_thread;
+static ALLEGRO_MUTEX* s_music_mutex;
+static ALLEGRO_EVENT_QUEUE* s_music_queue;
+static MusicCacheJob s_music_cache_job;
+static MusicCacheJob s_music_cache_done; /*!< A recorded track, for the music thread to save. */
 
 static ALLEGRO_SAMPLE* s_sample[SAMPLEID_MAX];
 static ALLEGRO_SAMPLE_INSTANCE* s_instance[MAX_SAMPLE_INSTANCES];
+static SampleVoice s_voice[MAX_SAMPLE_INSTANCES];
 static ALLEGRO_VOICE* al_voice;
 static ALLEGRO_MIXER* al_mixer;
 
 static char *AudioA5_LoadMusic(const MusicInfo *mid, uint32 *ret_length);
 static void AudioA5_FreeMusicStream();
 static ALLEGRO_AUDIO_STREAM *AudioA5_InitAdlib(const MusicInfo *mid);
+static void AudioA5_FreeMusicCacheJob(MusicCacheJob* job);
+static void* AudioA5_MusicThread(ALLEGRO_THREAD* thread, void* arg);
 
 /*--------------------------------------------------------------*/
 
+/* The music stream and the AdLib emulator are shared with the music thread. */
+static void AudioA5_LockMusic()
+{
+	if (s_music_mutex != NULL)
+		al_lock_mutex(s_music_mutex);
+}
+
+static void AudioA5_UnlockMusic()
+{
+	if (s_music_mutex != NULL)
+		al_unlock_mutex(s_music_mutex);
+}
+
+/* Without a music thread, the main loop renders music through
+ * AudioA5_PollMusic, as fragment events arrive in the input queue.
+ */
+static void AudioA5_InitMusicThread()
+{
+	s_music_mutex = al_create_mutex_recursive();
+	s_music_queue = al_create_event_queue();
+
+	if (s_music_mutex != NULL && s_music_queue != NULL)
+	{
+		s_music_thread = al_create_thread(AudioA5_MusicThread, NULL);
+
+		if (s_music_thread != NULL)
+		{
+			al_start_thread(s_music_thread);
+			return;
+		}
+	}
+
+	fprintf(stderr, "Could not start the music thread.\n");
+
+	if (s_music_queue != NULL)
+		al_destroy_event_queue(s_music_queue);
+
+	if (s_music_mutex != NULL)
+		al_destroy_mutex(s_music_mutex);
+
+	s_music_queue = NULL;
+	s_music_mutex = NULL;
+}
+
+static void AudioA5_UninitMusicThread()
+{
+	if (s_music_thread == NULL)
+		return;
+
+	/* Joins the thread. */
+	al_destroy_thread(s_music_thread);
+	al_destroy_event_queue(s_music_queue);
+	al_destroy_mutex(s_music_mutex);
+
+	s_music_thread = NULL;
+	s_music_queue = NULL;
+	s_music_mutex = NULL;
+}
+
 void AudioA5_Init()
 {
 	if (!al_install_audio())
@@ -78,8 +173,12 @@ void AudioA5_Init()
 
 	al_init_acodec_addon();
 
+	AudioA5_InitMusicThread();
+
+	AudioA5_LockMusic();
 	if (s_effect_stream == NULL)
 		s_effect_stream = AudioA5_InitAdlib(&g_table_music[MUSIC_IDLE1]);
+	AudioA5_UnlockMusic();
 	return;
 
 audio_init_failed:
@@ -108,8 +207,15 @@ void AudioA5_Uninit()
 		s_instance[i] = NULL;
 	}
 
+	AudioA5_UninitMusicThread();
+	AudioA5_FreeMusicCacheJob(&s_music_cache_job);
+	AudioA5_FreeMusicCacheJob(&s_music_cache_done);
 	AudioA5_FreeMusicStream();
 
+	if (s_music_stream != NULL && s_music_stream != s_effect_stream)
+		al_destroy_audio_stream(s_music_stream);
+	s_music_stream = NULL;
+
 	if (s_effect_stream != NULL)
 	{
 		al_destroy_audio_stream(s_effect_stream);
@@ -179,7 +285,7 @@ static ALLEGRO_AUDIO_STREAM* AudioA5_InitAdlib(const MusicInfo* mid)
 	al_set_audio_stream_gain(stream, music_volume);
 	al_set_audio_stream_pan(stream, ALLEGRO_AUDIO_PAN_NONE);
 	al_attach_audio_stream_to_mixer(stream, al_mixer);
-	al_register_event_source(g_a5_input_queue, al_get_audio_stream_event_source(stream));
+	al_register_event_source((s_music_queue != NULL) ? s_music_queue : g_a5_input_queue, al_get_audio_stream_event_source(stream));
 	return stream;
 }
 static void AudioA5_FreeMusicStream()
@@ -194,15 +300,188 @@ static void AudioA5_FreeMusicStream()
 	}
 }
 
+/*--------------------------------------------------------------*/
+
+/* With the music cache enabled, a track played through the emulator is
+ * recorded as the music thread renders it, and saved as a WAV file when it
+ * ends. It is streamed from that file afterwards. Tracks that loop, and
+ * tracks that had an AdLib sound effect mixed in, are not saved.
+ */
+
+static bool AudioA5_IsCachedMusic()
+{
+	return (s_music_stream != NULL && s_music_stream != s_effect_stream);
+}
+
+static void AudioA5_MakeMusicCacheFilename(char* buf, size_t len, const MusicInfo* mid)
+{
+	char name[128];
+
+	snprintf(name, sizeof(name), "music/%s-%d-%s.wav", mid->filename, mid->track, g_opl_mame ? "mame" : "dosbox");
+	File_MakeCompleteFilename(buf, len, SEARCHDIR_SAVE_DIR, name, true);
+}
+
+static ALLEGRO_AUDIO_STREAM* AudioA5_LoadCachedMusic(const char* filename)
+{
+	if (!al_filename_exists(filename))
+		return NULL;
+
+	ALLEGRO_AUDIO_STREAM* stream = al_load_audio_stream(filename, NUMFRAGS, FRAGLEN);
+	if (stream == NULL)
+		return NULL;
+
+	al_set_audio_stream_playmode(stream, ALLEGRO_PLAYMODE_ONCE);
+	al_set_audio_stream_gain(stream, music_volume);
+	al_set_audio_stream_pan(stream, ALLEGRO_AUDIO_PAN_NONE);
+	return stream;
+}
+
+static void AudioA5_FreeMusicCacheJob(MusicCacheJob* job)
+{
+	free(job->buf);
+	job->buf = NULL;
+	job->recording = false;
+	job->length = 0;
+	job->capacity = 0;
+}
+
+/* Add a rendered fragment to the track being recorded. Call with the music lock held. */
+static void AudioA5_RecordMusicCache(const int16* frag, int samples)
+{
+	MusicCacheJob* job = &s_music_cache_job;
+
+	if (!job->recording)
+		return;
+
+	if (s_adlib->hasLooped() || job->length + samples > MUSIC_CACHE_MAX_LENGTH)
+	{
+		AudioA5_FreeMusicCacheJob(job);
+		return;
+	}
+
+	if (job->length + samples > job->capacity)
+	{
+		const int capacity = (job->capacity == 0) ? 64 * FRAGLEN : 2 * job->capacity;
+		int16* buf = (int16*)realloc(job->buf, capacity * sizeof(int16));
+
+		if (buf == NULL)
+		{
+			AudioA5_FreeMusicCacheJob(job);
+			return;
+		}
+
+		job->buf = buf;
+		job->capacity = capacity;
+	}
+
+	memcpy(job->buf + job->length, frag, samples * sizeof(int16));
+	job->length += samples;
+
+	if (s_adlib->isPlaying())
+		return;
+
+	/* The track ended; hand it to the music thread to save. */
+	if (s_music_cache_done.buf == NULL)
+	{
+		s_music_cache_done = *job;
+		s_music_cache_done.recording = false;
+		job->buf = NULL;
+	}
+
+	AudioA5_FreeMusicCacheJob(job);
+}
+
+/* Save a recorded track. Called on the music thread, without the music lock. */
+static void AudioA5_SaveMusicCache(MusicCacheJob* job)
+{
+	char dir[1024];
+	char tmpname[1024 + 8];
+
+	/* Drop the silence after the last note. */
+	while (job->length > 0 && job->buf[job->length - 1] == 0)
+		job->length--;
+
+	if (job->length == 0)
+		return;
+
+	File_MakeCompleteFilename(dir, sizeof(dir), SEARCHDIR_SAVE_DIR, "music", false);
+	if (!al_make_directory(dir))
+		return;
+
+	ALLEGRO_SAMPLE* sample = al_create_sample(job->buf, job->length, SRATE, ALLEGRO_AUDIO_DEPTH_INT16, ALLEGRO_CHANNEL_CONF_1, false);
+	if (sample == NULL)
+		return;
+
+	/* Write to a temporary file first so a partial file is never streamed. */
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", job->filename);
+
+	ALLEGRO_FILE* f = al_fopen(tmpname, "wb");
+	bool saved = false;
+	if (f != NULL)
+	{
+		saved = al_save_sample_f(f, ".wav", sample);
+		saved = al_fclose(f) && saved;
+	}
+	al_destroy_sample(sample);
+
+	if (saved)
+	{
+		remove(job->filename);
+		saved = (rename(tmpname, job->filename) == 0);
+	}
+
+	if (!saved)
+	{
+		fprintf(stderr, "Could not write %s.\n", job->filename);
+		remove(tmpname);
+	}
+}
+
+/*--------------------------------------------------------------*/
+
 void AudioA5_InitMusic(const MusicInfo* m)
 {
 	const int track = m->track;
+	const bool useCache = g_music_cache && s_music_thread != NULL;
+	ALLEGRO_AUDIO_STREAM* cached = NULL;
+	char filename[1024];
+
+	/* Open the cached file before taking the lock, so the music thread does not wait for it. */
+	if (useCache)
+	{
+		AudioA5_MakeMusicCacheFilename(filename, sizeof(filename), m);
+		cached = AudioA5_LoadCachedMusic(filename);
+	}
+
+	AudioA5_LockMusic();
+
+	AudioA5_FreeMusicCacheJob(&s_music_cache_job);
+
+	if (AudioA5_IsCachedMusic())
+		al_destroy_audio_stream(s_music_stream);
+	else if (s_music_stream != NULL && s_adlib != NULL)
+		s_adlib->haltTrack();
+	s_music_stream = NULL;
+
+	if (cached != NULL && s_effect_stream != NULL)
+	{
+		al_attach_audio_stream_to_mixer(cached, al_mixer);
+		s_music_stream = cached;
+		AudioA5_UnlockMusic();
+		return;
+	}
+
+	if (cached != NULL)
+		al_destroy_audio_stream(cached);
 
 	AudioA5_FreeMusicStream();
 
 	ALLEGRO_AUDIO_STREAM* stream = AudioA5_InitAdlib(m);
 	if (stream == NULL)
+	{
+		AudioA5_UnlockMusic();
 		return;
+	}
 
 	if (s_effect_stream != NULL)
 		al_destroy_audio_stream(s_effect_stream);
@@ -210,47 +489,116 @@ void AudioA5_InitMusic(const MusicInfo* m)
 	s_adlib->playTrack(track);
 	s_music_stream = stream;
 	s_effect_stream = stream;
+
+	if (useCache)
+	{
+		s_music_cache_job.recording = true;
+		snprintf(s_music_cache_job.filename, sizeof(s_music_cache_job.filename), "%s", filename);
+	}
+
+	AudioA5_UnlockMusic();
 }
 
 void AudioA5_SetMusicVolume(float volume)
 {
+	AudioA5_LockMusic();
 	if (s_music_stream != NULL)
 		al_set_audio_stream_gain(s_music_stream, volume);
+	AudioA5_UnlockMusic();
 }
 
 void AudioA5_StopMusic()
 {
 	/* We retain Adlib for sound effects.
 	 */
+	AudioA5_LockMusic();
+	AudioA5_FreeMusicCacheJob(&s_music_cache_job);
+
+	if (AudioA5_IsCachedMusic())
+		al_set_audio_stream_playing(s_music_stream, false);
+
 	if (s_adlib != NULL)
 		s_adlib->haltTrack();
+	AudioA5_UnlockMusic();
 }
 
-void AudioA5_PollMusic()
+/* Render every fragment the stream has room for. */
+static void AudioA5_FillMusicStream()
 {
 	ALLEGRO_AUDIO_STREAM* stream = s_effect_stream;
 
-
 	if (s_adlib == NULL || stream == NULL)
 		return;
 
-	void* frag = al_get_audio_stream_fragment(stream);
-	if (frag == NULL)
+	void* frag;
+	while ((frag = al_get_audio_stream_fragment(stream)) != NULL)
+	{
+		s_adlib->callback(s_adlib, (uint8 *)frag, FRAGLEN * al_get_audio_depth_size(ALLEGRO_AUDIO_DEPTH_INT16));
+		AudioA5_RecordMusicCache((const int16 *)frag, FRAGLEN);
+		al_set_audio_stream_fragment(stream, frag);
+	}
+}
+
+static void* AudioA5_MusicThread(ALLEGRO_THREAD* thread, void* arg)
+{
+	(void)arg;
+
+	while (!al_get_thread_should_stop(thread))
+	{
+		ALLEGRO_EVENT event;
+
+		/* Wake up now and then to see if we should stop. */
+		if (!al_wait_for_event_timed(s_music_queue, &event, 0.1f))
+			continue;
+
+		if (event.type != ALLEGRO_EVENT_AUDIO_STREAM_FRAGMENT)
+			continue;
+
+		MusicCacheJob done;
+
+		AudioA5_LockMusic();
+		AudioA5_FillMusicStream();
+		done = s_music_cache_done;
+		s_music_cache_done.buf = NULL;
+		AudioA5_UnlockMusic();
+
+		if (done.buf != NULL)
+		{
+			AudioA5_SaveMusicCache(&done);
+			AudioA5_FreeMusicCacheJob(&done);
+		}
+	}
+
+	return NULL;
+}
+
+void AudioA5_PollMusic()
+{
+	/* The music thread keeps the stream filled. */
+	if (s_music_thread != NULL)
 		return;
 
-	s_adlib->callback(s_adlib, (uint8 *)frag, FRAGLEN * al_get_audio_depth_size(ALLEGRO_AUDIO_DEPTH_INT16));
-	al_set_audio_stream_fragment(stream, frag);
+	AudioA5_FillMusicStream();
 }
 
 bool AudioA5_MusicIsPlaying()
 {
-	return s_adlib->isPlaying();
+	AudioA5_LockMusic();
+	const bool playing = AudioA5_IsCachedMusic() ? al_get_audio_stream_playing(s_music_stream) : s_adlib->isPlaying();
+	AudioA5_UnlockMusic();
+
+	return playing;
 }
 
 void AudioA5_PlaySoundEffect(SoundID effectID)
 {
+	AudioA5_LockMusic();
 	if (s_adlib != NULL)
 		s_adlib->playSoundEffect(effectID);
+
+	/* The effect would be mixed into the recording. */
+	AudioA5_FreeMusicCacheJob(&s_music_cache_job);
+	AudioA5_UnlockMusic();
 }
 
 void AudioA5_StoreSample(SampleID sampleID, uint8 file_index, uint32 file_size)
@@ -277,9 +625,115 @@ void AudioA5_StoreSample(SampleID sampleID, uint8 file_index, uint32 file_size)
 	s_sample[sampleID] = al_create_sample(data, size - 2, freq, depth, chan_conf, true);
 }
 
+/**
+ * Priority of a battle sound: big events first, then the closer sound.
+ *  Interface sounds come last, so a click never cuts off a battle sound.
+ *
+ * @param volume Volume from 0.0f (far away) to 1.0f.
+ */
+static int AudioA5_GetSamplePriority(SampleID sampleID, float volume)
+{
+	int priority;
+
+	switch (sampleID)
+	{
+	case SAMPLE_STRUCTURE_DESTROYED:
+	case SAMPLE_EXPLODE_LARGE:
+	case SAMPLE_SANDWORM:
+		priority = 3;
+		break;
+
+	case SAMPLE_ROCKET:
+	case SAMPLE_EXPLODE_MEDIUM:
+	case SAMPLE_EXPLODE_CANNON:
+	case SAMPLE_EXPLODE_GAS:
+	case SAMPLE_MINI_ROCKET:
+		priority = 2;
+		break;
+
+	case SAMPLE_BUTTON:
+	case SAMPLE_PLACEMENT:
+		priority = 0;
+		break;
+
+	default:
+		priority = 1;
+		break;
+	}
+
+	return (priority << 8) + (int)(255.0f * clamp(0.0f, volume, 1.0f));
+}
+
+/**
+ * Find an instance to play a sample on.
+ *
+ * @param priority If not negative, a playing sample of lower priority
+ *                 may be cut off when all instances are in use.
+ * @return The instance, or -1 if none.
+ */
+static int AudioA5_FindSampleVoice(int idx_start, int idx_end, int priority)
+{
+	const double now = al_get_time();
+	int victim = -1;
+
+	for (int i = idx_start; i <= idx_end; i++)
+	{
+		const SampleVoice* v = &s_voice[i];
+
+		if (v->end <= now)
+			return i;
+
+		if (priority < 0 || v->priority >= priority)
+			continue;
+
+		/* Cut off the least important, or the one closest to finishing. */
+		if (victim == -1 || v->priority < s_voice[victim].priority ||
+				(v->priority == s_voice[victim].priority && v->end < s_voice[victim].end))
+			victim = i;
+	}
+
+	if (victim != -1)
+		al_stop_sample_instance(s_instance[victim]);
+
+	return victim;
+}
+
+static bool AudioA5_PlaySampleVoice(SampleID sampleID, float volume, float pan, int idx_start, int idx_end, int priority)
+{
+	if (s_sample[sampleID] == NULL)
+		return true;
+
+	if (pan < -100.0f)
+		pan = ALLEGRO_AUDIO_PAN_NONE;
+
+	const int i = AudioA5_FindSampleVoice(idx_start, idx_end, priority);
+	if (i == -1)
+		return false;
+
+	ALLEGRO_SAMPLE_INSTANCE* si = s_instance[i];
+	SampleVoice* v = &s_voice[i];
+
+	if (!al_set_sample(si, s_sample[sampleID]))
+	{
+		v->end = 0.0;
+		return false;
+	}
+
+	al_set_sample_instance_gain(si, volume);
+	al_set_sample_instance_pan(si, pan);
+	al_play_sample_instance(si);
+
+	v->sampleID = sampleID;
+	v->priority = priority;
+	v->gain = volume;
+	v->end = al_get_time() + al_get_sample_instance_time(si);
+	return true;
+}
+
 bool AudioA5_PlaySample(SampleID sampleID, float volume, float pan)
 {
 	int idx_start, idx_end;
+	int priority = -1;
 	float gain;
 
 	if (s_sample[sampleID] == NULL)
@@ -302,39 +756,41 @@ bool AudioA5_PlaySample(SampleID sampleID, float volume, float pan)
 	}
 	else
 	{
-		idx_start = 2;
+		idx_start = SAMPLE_INSTANCE_BATTLE;
 		idx_end = MAX_SAMPLE_INSTANCES - 1;
 		gain = sound_volume * volume;
+		priority = AudioA5_GetSamplePriority(sampleID, volume);
 	}
 
-	return AudioA5_PlaySampleRaw(sampleID, gain, pan, idx_start, idx_end);
+	return AudioA5_PlaySampleVoice(sampleID, gain, pan, idx_start, idx_end, priority);
 }
 
-bool AudioA5_PlaySampleRaw(SampleID sampleID, float volume, float pan, int idx_start, int idx_end)
+/**
+ * Fold a battle sound into an identical one that has just started,
+ * raising its volume if the new one is closer.
+ */
+void AudioA5_MergeSample(SampleID sampleID, float volume, float pan)
 {
-	if (s_sample[sampleID] == NULL)
-		return true;
-
-	if (pan < -100.0f)
-		pan = ALLEGRO_AUDIO_PAN_NONE;
+	const double now = al_get_time();
+	const float gain = sound_volume * volume;
 
-	for (int i = idx_start; i <= idx_end; i++)
+	for (int i = SAMPLE_INSTANCE_BATTLE; i < MAX_SAMPLE_INSTANCES; i++)
 	{
-		ALLEGRO_SAMPLE_INSTANCE* si = s_instance[i];
+		SampleVoice* v = &s_voice[i];
 
-		if (al_get_sample_instance_playing(si))
+		if (v->sampleID != sampleID || v->end <= now || v->gain >= gain)
 			continue;
 
-		if (!al_set_sample(si, s_sample[sampleID]))
-			continue;
-
-		al_set_sample_instance_gain(si, volume);
-		al_set_sample_instance_pan(si, pan);
-		al_play_sample_instance(si);
-		return true;
+		al_set_sample_instance_gain(s_instance[i], gain);
+		al_set_sample_instance_pan(s_instance[i], (pan < -100.0f) ? ALLEGRO_AUDIO_PAN_NONE : pan);
+		v->priority = AudioA5_GetSamplePriority(sampleID, volume);
+		v->gain = gain;
 	}
+}
 
-	return false;
+bool AudioA5_PlaySampleRaw(SampleID sampleID, float volume, float pan, int idx_start, int idx_end)
+{
+	return AudioA5_PlaySampleVoice(sampleID, volume, pan, idx_start, idx_end, -1);
 }
 
 bool AudioA5_PollNarrator()
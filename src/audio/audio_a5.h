@@ -16,6 +16,7 @@ void AudioA5_PlaySoundEffect(SoundID effectID);
 
 void AudioA5_StoreSample(SampleID sampleID, uint8 file_index, uint32 file_size);
 bool AudioA5_PlaySample(SampleID sampleID, float volume, float pan);
+void AudioA5_MergeSample(SampleID sampleID, float volume, float pan);
 bool AudioA5_PlaySampleRaw(SampleID sampleID, float volume, float pan, int idx_start, int idx_end);
 bool AudioA5_PollNarrator();
 
@@ -149,6 +149,16 @@ public:
 		_syncJumpMask = mask;
 	}
 
+	void setLooped(bool looped)
+	{
+		_looped = looped;
+	}
+
+	bool hasLooped() const
+	{
+		return _looped;
+	}
+
 private:
 	struct OpcodeEntry
 	{
@@ -476,6 +486,8 @@ private:
 
 	uint16 _syncJumpMask;
 
+	bool _looped; /*!< A channel jumped backwards, so the track loops. */
+
 	bool _v2;
 
 	void lock()
@@ -535,6 +547,7 @@ AdLibDriver::AdLibDriver(int rate, bool bMAME)
 	_samplesTillCallbackRemainder = 0;
 
 	_syncJumpMask = 0;
+	_looped = false;
 }
 
 AdLibDriver::~AdLibDriver()
@@ -1591,6 +1604,8 @@ int AdLibDriver::update_jump(uint8*& dataptr, Channel& channel, uint8 value)
 	int16 add = READ_LE_UINT16(dataptr);
 	dataptr += 2;
 	dataptr += add;
+	if (add < 0)
+		_looped = true;
 	if (_syncJumpMask & (1 << (&channel - _channels)))
 		channel.lock = true;
 	return 0;
@@ -2620,6 +2635,7 @@ void SoundAdLibPC::process()
 void SoundAdLibPC::playTrack(uint8 track)
 {
 	_driver->setSyncJumpMask(0);
+	_driver->setLooped(false);
 	play(track);
 }
 
@@ -2636,6 +2652,15 @@ bool SoundAdLibPC::isPlaying() const
 	return (bJustStartedPlaying == true) || (_driver->callback(7, int(0)) != 0);
 }
 
+/**
+ * Whether the track started by playTrack() went back to an earlier part,
+ *  which means it will not end by itself.
+ */
+bool SoundAdLibPC::hasLooped() const
+{
+	return _driver->hasLooped();
+}
+
 void SoundAdLibPC::playSoundEffect(uint8 track)
 {
 	play(track);
@@ -2654,29 +2679,37 @@ void SoundAdLibPC::callback(void* userdata, uint8* audiobuf, int len)
 
 	int numSamples = len / (self->getsampsize());
 
-	int16* tmpBuf = (int16*) calloc(numSamples, sizeof(int16));
-	if (tmpBuf == NULL)
-	{
-		warning("Not enough memory!");
-		return;
-	}
-
-	// write mono 16-bit signed samples (in system endianess)
-	self->_driver->readBuffer((int16*) tmpBuf, numSamples);
-
+	// the driver writes mono 16-bit signed samples (in system endianess);
 	// now convert to target format
 	switch (self->m_format)
 	{
 	case AUDIO_S16LSB:
 		{
-			int16_t* out = (int16_t*) audiobuf;
+			int16* out = (int16*) audiobuf;
+
+			// mono output needs no conversion, render straight into it
+			if (self->m_channels == 1)
+			{
+				self->_driver->readBuffer(out, numSamples);
+				break;
+			}
 
-			for (int i = 0; i < numSamples; i++)
+			// otherwise render in pieces and copy to every channel
+			while (numSamples > 0)
 			{
-				for (int j = 0; j < self->m_channels; j++ , out++)
+				const int render = std::min(numSamples, (int)(sizeof(self->_renderBuf) / sizeof(self->_renderBuf[0])));
+
+				self->_driver->readBuffer(self->_renderBuf, render);
+
+				for (int i = 0; i < render; i++)
 				{
-					*out = tmpBuf[i];
+					for (int j = 0; j < self->m_channels; j++ , out++)
+					{
+						*out = self->_renderBuf[i];
+					}
 				}
+
+				numSamples -= render;
 			}
 		}
 		break;
@@ -2688,8 +2721,6 @@ void SoundAdLibPC::callback(void* userdata, uint8* audiobuf, int len)
 		}
 	}
 
-	free(tmpBuf);
-
 	self->bJustStartedPlaying = false;
 }
 
@@ -76,6 +76,7 @@ public:
 	void haltTrack();
 
 	bool isPlaying() const;
+	bool hasLooped() const;
 
 	void playSoundEffect(uint8 track);
 
@@ -104,6 +105,8 @@ private:
 	int m_freq;
 	uint16 m_format;
 
+	int16 _renderBuf[1024]; // used when the output has more than one channel
+
 	bool bJustStartedPlaying;
 };
 
@@ -0,0 +1,418 @@
+/** @file src/balance.cpp Balance table routines.
+ *
+ * balance.ini in the data directory can change the numbers of the unit,
+ *  structure and house tables, with a section for each entry:
+ *
+ *    [unit:Siege Tank]
+ *    hitpoints=150
+ *    damage=40
+ *
+ * Looking up every key of every entry in the INI text is slow, so the
+ *  resulting values are kept in balance.bin in the save directory. The
+ *  cache is used when it was made from the same balance.ini and the same
+ *  built-in tables, and the hash of its values checks out. While playing,
+ *  the modification time of balance.ini is checked every few seconds, and
+ *  the tables are reloaded when its contents changed.
+ */
+
+#include <allegro5/allegro.h>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "types.h"
+
+#include "balance.h"
+
+#include "file.h"
+#include "house.h"
+#include "ini.h"
+#include "multichar.h"
+#include "os/common.h"
+#include "pool/pool.h"
+#include "pool/housepool.h"
+#include "pool/structurepool.h"
+#include "pool/unitpool.h"
+#include "saveload/saveload.h"
+#include "structure.h"
+#include "unit.h"
+
+enum
+{
+	BALANCE_VERSION = 1,
+	BALANCE_VALUES_MAX = 2048
+};
+
+#define BALANCE_FILENAME "balance.ini"
+#define BALANCE_CACHE_FILENAME "balance.bin"
+
+/** A number in a table that balance.ini can change. */
+struct BalanceField
+{
+	const char* key; /*!< The key in balance.ini. */
+	size_t offset; /*!< The offset in the table entry, in bytes. */
+	SaveLoadType type; /*!< The type of the number. */
+};
+
+#define BALANCE_FIELD(c, k, t, m) { k, offset(c, m), t }
+#define BALANCE_END { NULL, 0, SLDT_NULL }
+
+static const BalanceField s_unitFields[] = {
+	BALANCE_FIELD(UnitInfo, "hitpoints",           SLDT_UINT16, o.hitpoints),
+	BALANCE_FIELD(UnitInfo, "build_credits",       SLDT_UINT16, o.buildCredits),
+	BALANCE_FIELD(UnitInfo, "build_time",          SLDT_UINT16, o.buildTime),
+	BALANCE_FIELD(UnitInfo, "fog_uncover_radius",  SLDT_UINT16, o.fogUncoverRadius),
+	BALANCE_FIELD(UnitInfo, "priority_build",      SLDT_UINT16, o.priorityBuild),
+	BALANCE_FIELD(UnitInfo, "priority_target",     SLDT_UINT16, o.priorityTarget),
+	BALANCE_FIELD(UnitInfo, "moving_speed_factor", SLDT_UINT16, movingSpeedFactor),
+	BALANCE_FIELD(UnitInfo, "turning_speed",       SLDT_UINT8,  turningSpeed),
+	BALANCE_FIELD(UnitInfo, "fire_delay",          SLDT_UINT16, fireDelay),
+	BALANCE_FIELD(UnitInfo, "fire_distance",       SLDT_UINT16, fireDistance),
+	BALANCE_FIELD(UnitInfo, "damage",              SLDT_UINT16, damage),
+	BALANCE_END
+};
+
+static const BalanceField s_structureFields[] = {
+	BALANCE_FIELD(StructureInfo, "hitpoints",          SLDT_UINT16, o.hitpoints),
+	BALANCE_FIELD(StructureInfo, "build_credits",      SLDT_UINT16, o.buildCredits),
+	BALANCE_FIELD(StructureInfo, "build_time",         SLDT_UINT16, o.buildTime),
+	BALANCE_FIELD(StructureInfo, "fog_uncover_radius", SLDT_UINT16, o.fogUncoverRadius),
+	BALANCE_FIELD(StructureInfo, "spawn_chance",       SLDT_UINT16, o.spawnChance),
+	BALANCE_FIELD(StructureInfo, "priority_build",     SLDT_UINT16, o.priorityBuild),
+	BALANCE_FIELD(StructureInfo, "priority_target",    SLDT_UINT16, o.priorityTarget),
+	BALANCE_FIELD(StructureInfo, "credits_storage",    SLDT_UINT16, creditsStorage),
+	BALANCE_FIELD(StructureInfo, "power_usage",        SLDT_INT16,  powerUsage),
+	BALANCE_END
+};
+
+static const BalanceField s_houseFields[] = {
+	BALANCE_FIELD(HouseInfo, "toughness",              SLDT_UINT16, toughness),
+	BALANCE_FIELD(HouseInfo, "degrading_chance",       SLDT_UINT16, degradingChance),
+	BALANCE_FIELD(HouseInfo, "degrading_amount",       SLDT_UINT16, degradingAmount),
+	BALANCE_FIELD(HouseInfo, "special_countdown",      SLDT_UINT16, specialCountDown),
+	BALANCE_FIELD(HouseInfo, "starport_delivery_time", SLDT_UINT16, starportDeliveryTime),
+	BALANCE_END
+};
+
+/** A table that balance.ini can change. */
+struct BalanceTable
+{
+	const char* section; /*!< The prefix of the sections in balance.ini. */
+	const BalanceField* fields; /*!< The numbers that can be changed. */
+	const void* base; /*!< The built-in table. */
+	void* table; /*!< The table used in game. */
+	size_t entrySize; /*!< The size of an entry. */
+	size_t nameOffset; /*!< The offset of the name of an entry. */
+	int count; /*!< The number of entries. */
+};
+
+static const BalanceTable s_balanceTable[] = {
+	{ "unit",      s_unitFields,      g_table_base_unitInfo,      g_table_unitInfo,      sizeof(UnitInfo),      offset(UnitInfo, o.name),      UNIT_MAX },
+	{ "structure", s_structureFields, g_table_base_structureInfo, g_table_structureInfo, sizeof(StructureInfo), offset(StructureInfo, o.name), STRUCTURE_MAX },
+	{ "house",     s_houseFields,     g_table_base_houseInfo,     g_table_houseInfo,     sizeof(HouseInfo),     offset(HouseInfo, name),       HOUSE_MAX },
+};
+
+static int32 s_value[BALANCE_VALUES_MAX]; /*!< The numbers of all tables, in the order of s_balanceTable. */
+static uint16 s_valueCount;
+static uint32 s_sourceHash; /*!< Hash of balance.ini and the built-in tables, or 0 without balance.ini. */
+static time_t s_sourceTime; /*!< Modification time of balance.ini when it was read, or 0 without balance.ini. */
+
+static int32 Balance_GetField(const void* entry, const BalanceField* f)
+{
+	const uint8* p = (const uint8 *)entry + f->offset;
+
+	switch (f->type)
+	{
+	case SLDT_UINT8:  return *(const uint8 *)p;
+	case SLDT_UINT16: return *(const uint16 *)p;
+	case SLDT_INT16:  return *(const int16 *)p;
+	default:          return 0;
+	}
+}
+
+static void Balance_SetField(void* entry, const BalanceField* f, int32 value)
+{
+	uint8* p = (uint8 *)entry + f->offset;
+
+	switch (f->type)
+	{
+	case SLDT_UINT8:  *(uint8 *)p = (uint8)value; break;
+	case SLDT_UINT16: *(uint16 *)p = (uint16)value; break;
+	case SLDT_INT16:  *(int16 *)p = (int16)value; break;
+	default:          break;
+	}
+}
+
+/**
+ * Continue a FNV-1a hash.
+ *
+ * @param hash The hash so far.
+ * @param data The data to add.
+ * @param length The length of the data.
+ * @return The new hash.
+ */
+static uint32 Balance_Hash(uint32 hash, const void* data, size_t length)
+{
+	const uint8* p = (const uint8 *)data;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ p[i]) * 16777619u;
+
+	return hash;
+}
+
+/**
+ * Get the hash of balance.ini, seeded with the numbers of the built-in
+ *  tables so a cache made for other tables is not used.
+ *
+ * @return The hash, or 0 if there is no balance.ini.
+ */
+static uint32 Balance_GetSourceHash(char** source)
+{
+	uint32 hash = 2166136261u;
+
+	*source = NULL;
+
+	if (!File_Exists_Ex(SEARCHDIR_DATA_DIR, BALANCE_FILENAME))
+		return 0;
+
+	for (int t = 0; t < (int)lengthof(s_balanceTable); t++)
+	{
+		const BalanceTable* table = &s_balanceTable[t];
+
+		for (int i = 0; i < table->count; i++)
+		{
+			const void* base = (const uint8 *)table->base + i * table->entrySize;
+
+			for (const BalanceField* f = table->fields; f->key != NULL; f++)
+			{
+				const int32 value = Balance_GetField(base, f);
+				hash = Balance_Hash(hash, &value, sizeof(value));
+			}
+		}
+	}
+
+	*source = (char *)File_ReadWholeFile_Ex(SEARCHDIR_DATA_DIR, BALANCE_FILENAME);
+	hash = Balance_Hash(hash, *source, strlen(*source));
+
+	return (hash != 0) ? hash : 1;
+}
+
+/**
+ * Get the modification time of balance.ini, without reading it.
+ *
+ * @return The modification time, or 0 if there is no balance.ini.
+ */
+static time_t Balance_GetSourceTime()
+{
+	char filename[1024];
+
+	File_MakeCompleteFilename(filename, sizeof(filename), SEARCHDIR_DATA_DIR, BALANCE_FILENAME, false);
+
+	ALLEGRO_FS_ENTRY* e = al_create_fs_entry(filename);
+	if (e == NULL)
+		return 0;
+
+	const time_t mtime = al_fs_entry_exists(e) ? al_get_fs_entry_mtime(e) : 0;
+
+	al_destroy_fs_entry(e);
+	return mtime;
+}
+
+/**
+ * Read the numbers of all tables from balance.ini, using the built-in
+ *  numbers for what it does not change.
+ *
+ * @param source The contents of balance.ini, or NULL for the built-in numbers.
+ * @return The number of values.
+ */
+static uint16 Balance_Parse(char* source)
+{
+	uint16 n = 0;
+
+	for (int t = 0; t < (int)lengthof(s_balanceTable); t++)
+	{
+		const BalanceTable* table = &s_balanceTable[t];
+
+		for (int i = 0; i < table->count; i++)
+		{
+			const uint8* base = (const uint8 *)table->base + i * table->entrySize;
+			const char* name = *(const char* const*)(base + table->nameOffset);
+			char section[64];
+
+			if (name != NULL)
+				snprintf(section, sizeof(section), "%s:%s", table->section, name);
+
+			for (const BalanceField* f = table->fields; f->key != NULL; f++)
+			{
+				const int32 value = Balance_GetField(base, f);
+
+				assert(n < BALANCE_VALUES_MAX);
+				s_value[n++] = (source != NULL && name != NULL) ? Ini_GetInteger(section, f->key, value, source) : value;
+			}
+		}
+	}
+
+	return n;
+}
+
+static bool Balance_LoadCache(uint32 sourceHash, uint16 count)
+{
+	FILE* fp = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, BALANCE_CACHE_FILENAME, "rb");
+	if (fp == NULL)
+		return false;
+
+	uint32 header[5];
+	const bool valid = (fread(header, sizeof(header), 1, fp) == 1)
+		&& (header[0] == CC_DDBL) && (header[1] == BALANCE_VERSION) && (header[2] == sourceHash) && (header[3] == count)
+		&& (fread(s_value, sizeof(s_value[0]), count, fp) == count)
+		&& (Balance_Hash(2166136261u, s_value, count * sizeof(s_value[0])) == header[4]);
+
+	fclose(fp);
+	return valid;
+}
+
+static void Balance_SaveCache(uint32 sourceHash, uint16 count)
+{
+	FILE* fp = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, BALANCE_CACHE_FILENAME, "wb");
+	if (fp == NULL)
+		return;
+
+	const uint32 header[5] = { CC_DDBL, BALANCE_VERSION, sourceHash, count, Balance_Hash(2166136261u, s_value, count * sizeof(s_value[0])) };
+
+	fwrite(header, sizeof(header), 1, fp);
+	fwrite(s_value, sizeof(s_value[0]), count, fp);
+	fclose(fp);
+}
+
+/**
+ * Load the numbers of the tables, from the cache if it is up to date
+ *  and from balance.ini otherwise.
+ */
+void Balance_Load()
+{
+	char* source;
+	const uint32 sourceHash = Balance_GetSourceHash(&source);
+
+	s_valueCount = Balance_Parse(NULL);
+	s_sourceHash = sourceHash;
+	s_sourceTime = Balance_GetSourceTime();
+
+	if (source == NULL)
+		return;
+
+	if (!Balance_LoadCache(sourceHash, s_valueCount))
+	{
+		Balance_Parse(source);
+		Balance_SaveCache(sourceHash, s_valueCount);
+	}
+
+	free(source);
+}
+
+/**
+ * Put the loaded numbers in the tables used in game.
+ */
+void Balance_Apply()
+{
+	uint16 n = 0;
+
+	if (s_valueCount == 0)
+		return;
+
+	for (int t = 0; t < (int)lengthof(s_balanceTable); t++)
+	{
+		const BalanceTable* table = &s_balanceTable[t];
+
+		for (int i = 0; i < table->count; i++)
+		{
+			void* entry = (uint8 *)table->table + i * table->entrySize;
+
+			for (const BalanceField* f = table->fields; f->key != NULL; f++)
+				Balance_SetField(entry, f, s_value[n++]);
+		}
+	}
+}
+
+/**
+ * Bring the game in progress in line with reloaded tables. The house
+ *  totals were counted with the old numbers, and hitpoints may be above
+ *  the new maximum.
+ */
+static void Balance_RefreshGame()
+{
+	PoolFindStruct find;
+
+	find.houseID = HOUSE_INVALID;
+	find.index = 0xFFFF;
+	find.type = 0xFFFF;
+
+	while (true)
+	{
+		Structure* s = Structure_Find(&find);
+		if (s == NULL)
+			break;
+
+		const StructureInfo* si = &g_table_structureInfo[s->o.type];
+
+		if (s->o.hitpoints > si->o.hitpoints)
+			s->o.hitpoints = si->o.hitpoints;
+	}
+
+	find.houseID = HOUSE_INVALID;
+	find.index = 0xFFFF;
+	find.type = 0xFFFF;
+
+	while (true)
+	{
+		Unit* u = Unit_Find(&find);
+		if (u == NULL)
+			break;
+
+		const UnitInfo* ui = &g_table_unitInfo[u->o.type];
+
+		if (u->o.hitpoints > ui->o.hitpoints)
+			u->o.hitpoints = ui->o.hitpoints;
+	}
+
+	find.houseID = HOUSE_INVALID;
+	find.index = 0xFFFF;
+	find.type = 0xFFFF;
+
+	while (true)
+	{
+		House* h = House_Find(&find);
+		if (h == NULL)
+			break;
+
+		House_RecountStructures(h);
+		Structure_CalculateHitpointsMax(h);
+	}
+}
+
+/**
+ * Reload the tables if balance.ini was changed, added or removed.
+ *
+ * @return True if and only if the tables were reloaded.
+ */
+bool Balance_ReloadIfChanged()
+{
+	const time_t sourceTime = Balance_GetSourceTime();
+
+	if (sourceTime == s_sourceTime)
+		return false;
+
+	char* source;
+	const uint32 sourceHash = Balance_GetSourceHash(&source);
+
+	free(source);
+	s_sourceTime = sourceTime;
+
+	if (sourceHash == s_sourceHash)
+		return false;
+
+	Balance_Load();
+	Balance_Apply();
+	Balance_RefreshGame();
+	return true;
+}
@@ -0,0 +1,10 @@
+/** @file src/balance.h Balance table definitions. */
+
+#ifndef BALANCE_H
+#define BALANCE_H
+
+void Balance_Load();
+void Balance_Apply();
+bool Balance_ReloadIfChanged();
+
+#endif /* BALANCE_H */
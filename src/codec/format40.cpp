@@ -3,6 +3,7 @@
 #include "types.h"
 #include "format40.h"
 #include "../gfx.h"
+#include "../video/blit.h"
 
 /**
  * Decode a memory fragment which is encoded with 'format40'.
@@ -20,10 +21,8 @@ void Format40_Decode(uint8* dst, uint8* src)
 		if (flag == 0)
 		{
 			flag = *src++;
-			for (; flag > 0; flag--)
-			{
-				*dst++ ^= *src;
-			}
+			Blit_XorFill(dst, *src, flag);
+			dst += flag;
 			src++;
 
 			continue;
@@ -31,10 +30,9 @@ void Format40_Decode(uint8* dst, uint8* src)
 
 		if ((flag & 0x80) == 0)
 		{
-			for (; flag > 0; flag--)
-			{
-				*dst++ ^= *src++;
-			}
+			Blit_Xor(dst, src, flag);
+			dst += flag;
+			src += flag;
 			continue;
 		}
 
@@ -59,19 +57,16 @@ void Format40_Decode(uint8* dst, uint8* src)
 		if ((flag & 0x4000) == 0)
 		{
 			flag &= 0x3FFF;
-			for (; flag > 0; flag--)
-			{
-				*dst++ ^= *src++;
-			}
+			Blit_Xor(dst, src, flag);
+			dst += flag;
+			src += flag;
 			continue;
 		}
 
 		{
 			flag &= 0x3FFF;
-			for (; flag > 0; flag--)
-			{
-				*dst++ ^= *src;
-			}
+			Blit_XorFill(dst, *src, flag);
+			dst += flag;
 			src++;
 			continue;
 		}
@@ -10,6 +10,7 @@
 #include "config.h"
 #include "input/input_a5.h"
 #include "input/mouse.h"
+#include "parallel_a5.h"
 #include "timer/timer_a5.h"
 #include "video/video_a5.h"
 
@@ -169,6 +170,7 @@ bool A5_Init()
 		return false;
 
 	AudioA5_Init();
+	ParallelA5_Init();
 	A5_InitTransform(true);
 
 	return true;
@@ -188,6 +190,7 @@ void A5_Uninit()
 		s_transform[div] = NULL;
 	}
 
+	ParallelA5_Uninit();
 	AudioA5_Uninit();
 	TimerA5_Uninit();
 	VideoA5_Uninit();
@@ -13,6 +13,7 @@
 #include "enhancement.h"
 #include "file.h"
 #include "gfx.h"
+#include "replay.h"
 #include "string.h"
 #include "video/video.h"
 
@@ -67,8 +68,10 @@ static int saved_screen_height = 720;
 static const GameOption s_game_option[] = {
 	{"game", "game_speed", CONFIG_INT_0_4, &g_gameConfig.gameSpeed},
 	{"game", "hints", CONFIG_BOOL, &g_gameConfig.hints},
+	{"game", "record_replay", CONFIG_BOOL, &g_record_replay},
 
 	{"graphics", "driver", CONFIG_GRAPHICS_DRIVER, &g_graphics_driver},
+	{"graphics", "palette_shader", CONFIG_BOOL, &g_palette_shader},
 	{"graphics", "window_mode", CONFIG_WINDOW_MODE, &g_gameConfig.windowMode},
 	{"graphics", "screen_width", CONFIG_INT, &saved_screen_width},
 	{"graphics", "screen_height", CONFIG_INT, &saved_screen_height},
@@ -92,9 +95,11 @@ static const GameOption s_game_option[] = {
 	{"audio", "sound_volume", CONFIG_FLOAT, &sound_volume},
 	{"audio", "voice_volume", CONFIG_FLOAT, &voice_volume},
 	{"audio", "opl_mame", CONFIG_BOOL, &g_opl_mame},
+	{"audio", "music_cache", CONFIG_BOOL, &g_music_cache},
 
 	{"enhancement", "brutal_ai", CONFIG_BOOL, &enhancement_brutal_ai},
 	{"enhancement", "fog_of_war", CONFIG_BOOL, &enhancement_fog_of_war},
+	{"enhancement", "spread_object_ticks", CONFIG_BOOL, &enhancement_spread_object_ticks},
 
 	{NULL, NULL, CONFIG_BOOL, NULL}
 };
@@ -22,3 +22,11 @@ bool enhancement_fog_covers_units = true;
  * Add non-permanent scouting.
  */
 bool enhancement_fog_of_war = false;
+
+/**
+ * In the original game, all unit and structure scripts run on the same
+ * tick, every fifth one.  Spread them over the ticks by index instead,
+ * for an even load; each object still runs at the same rate.  A replay
+ * only plays back in sync with the setting it was recorded with.
+ */
+bool enhancement_spread_object_ticks = false;
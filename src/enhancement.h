@@ -6,5 +6,6 @@
 extern bool enhancement_brutal_ai;
 extern bool enhancement_fog_covers_units;
 extern bool enhancement_fog_of_war;
+extern bool enhancement_spread_object_ticks;
 
 #endif
@@ -2,27 +2,33 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include "types.h"
+#include "os/math.h"
 
 #include "explosion.h"
 #include "animation.h"
 #include "audio/audio.h"
-#include "binheap.h"
 #include "enhancement.h"
+#include "gui/gui.h"
 #include "house.h"
 #include "map.h"
 #include "shape.h"
 #include "sprites.h"
 #include "structure.h"
+#include "table/widgetinfo.h"
 #include "timer/timer.h"
+#include "timerwheel.h"
 #include "tools/coord.h"
 #include "tools/random_general.h"
 #include "tools/random_lcg.h"
 
 typedef struct Explosion
 {
-	/* Heap key. */
 	int64_t timeOut; /*!< Time out for the next command. */
+	int handle; /*!< Handle of the Explosion in #s_explosions. */
+	int tileNext; /*!< Next Explosion on the same tile. */
+	int tilePrev; /*!< Previous Explosion on the same tile. */
 
 	bool isDirty; /*!< Does the Explosion require a redraw next round. */
 	uint8 current; /*!< Index in #commands pointing to the next command. */
@@ -31,10 +37,66 @@ typedef struct Explosion
 	tile32 position; /*!< Position where this explosion acts. */
 } Explosion;
 
-static BinHeap s_explosions;
+/**
+ * An Explosion as saved by Explosion_Save.
+ */
+typedef struct ExplosionSave
+{
+	int64_t timeOut; /*!< Time out for the next command. */
+	tile32 position; /*!< Position where this explosion acts. */
+	int16 type; /*!< Index of the commands in #g_table_explosion; -1 for none. */
+	uint16 tileDepth; /*!< Number of Explosions before it in the list of its tile. */
+	uint16 spriteID; /*!< SpriteID. */
+	uint8 current; /*!< Index in the commands pointing to the next command. */
+	uint8 isDirty; /*!< Does the Explosion require a redraw next round. */
+} ExplosionSave;
+
+static TimerWheel s_explosions;
+static int s_explosionByTile[MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< First Explosion on each tile. */
+static uint16 s_explosionLoadDepth; /*!< Deepest tile list position seen by Explosion_Load. */
 
 extern const ExplosionCommandStruct* g_table_explosion[EXPLOSIONTYPE_MAX];
 
+static Explosion* Explosion_Get(int handle)
+{
+	return (Explosion *)TimerWheel_Get(&s_explosions, handle);
+}
+
+/**
+ * Add a Explosion to the list of the tile it is on.
+ * @param e The Explosion to add.
+ */
+static void Explosion_LinkTile(Explosion* e)
+{
+	const uint16 packed = Tile_PackTile(e->position);
+
+	e->tilePrev = TIMERWHEEL_INVALID;
+	e->tileNext = s_explosionByTile[packed];
+
+	if (e->tileNext != TIMERWHEEL_INVALID)
+		Explosion_Get(e->tileNext)->tilePrev = e->handle;
+
+	s_explosionByTile[packed] = e->handle;
+}
+
+/**
+ * Remove a Explosion from the list of the tile it is on.
+ * @param e The Explosion to remove.
+ */
+static void Explosion_UnlinkTile(Explosion* e)
+{
+	if (e->tilePrev != TIMERWHEEL_INVALID)
+		Explosion_Get(e->tilePrev)->tileNext = e->tileNext;
+	else
+		s_explosionByTile[Tile_PackTile(e->position)] = e->tileNext;
+
+	if (e->tileNext != TIMERWHEEL_INVALID)
+		Explosion_Get(e->tileNext)->tilePrev = e->tilePrev;
+
+	e->tileNext = TIMERWHEEL_INVALID;
+	e->tilePrev = TIMERWHEEL_INVALID;
+}
+
 /**
  * Update the tile a Explosion is on.
  * @param type Are we introducing (0) or updating (2) the tile.
@@ -49,7 +111,6 @@ static void Explosion_Update(uint16 type, Explosion* e)
 		return;
 
 	e->isDirty = (type != 0);
-	Map_UpdateAround(24, e->position, NULL, g_functions[2][type]);
 }
 
 /**
@@ -82,6 +143,8 @@ static void Explosion_Func_TileDamage(Explosion* e, uint16 parameter)
 	if (type == LST_CONCRETE_SLAB)
 	{
 		t->groundSpriteID = g_mapSpriteID[packed];
+		g_mapRevision++;
+		Structure_InvalidateBuildIndex(packed);
 		Map_Update(packed, 0, false);
 	}
 
@@ -193,7 +256,9 @@ static void Explosion_Func_SetAnimation(Explosion* e, uint16 animationMapID)
  */
 static void Explosion_Func_MoveYPosition(Explosion* e, uint16 row)
 {
+	Explosion_UnlinkTile(e);
 	e->position.y += (int16)row;
+	Explosion_LinkTile(e);
 }
 
 /**
@@ -211,6 +276,11 @@ static void Explosion_Func_Stop(Explosion* e, uint16 parameter)
 	Explosion_Update(0, e);
 
 	e->commands = NULL;
+	Explosion_UnlinkTile(e);
+
+	/* A running Explosion is released by Explosion_Tick once it returns. */
+	if (TimerWheel_IsScheduled(&s_explosions, e->handle))
+		TimerWheel_Release(&s_explosions, e->handle);
 }
 
 /**
@@ -220,7 +290,7 @@ static void Explosion_Func_Stop(Explosion* e, uint16 parameter)
  */
 static void Explosion_Func_SetTimeout(Explosion* e, uint16 value)
 {
-	e->timeOut = Timer_GetTicks() + value;
+	e->timeOut = g_timerGame + value;
 }
 
 /**
@@ -230,7 +300,7 @@ static void Explosion_Func_SetTimeout(Explosion* e, uint16 value)
  */
 static void Explosion_Func_SetRandomTimeout(Explosion* e, uint16 value)
 {
-	e->timeOut = Timer_GetTicks() + Tools_RandomLCG_Range(0, value);
+	e->timeOut = g_timerGame + Tools_RandomLCG_Range(0, value);
 }
 
 /**
@@ -254,28 +324,23 @@ static void Explosion_StopAtPosition(uint16 packed)
 	if (!g_map[packed].hasExplosion)
 		return;
 
-	for (int i = 1; i < s_explosions.num_elem; i++)
-	{
-		Explosion* e = (Explosion *)BinHeap_GetElem(&s_explosions, i);
-
-		if (e->commands == NULL)
-			continue;
-		if (Tile_PackTile(e->position) != packed)
-			continue;
+	if (s_explosionByTile[packed] == TIMERWHEEL_INVALID)
+		return;
 
-		Explosion_Func_Stop(e, 0);
-		break;
-	}
+	Explosion_Func_Stop(Explosion_Get(s_explosionByTile[packed]), 0);
 }
 
 void Explosion_Init()
 {
-	BinHeap_Init(&s_explosions, sizeof(Explosion));
+	TimerWheel_Init(&s_explosions, sizeof(Explosion), g_timerGame);
+
+	/* All bits set is TIMERWHEEL_INVALID. */
+	memset(s_explosionByTile, 0xFF, sizeof(s_explosionByTile));
 }
 
 void Explosion_Uninit()
 {
-	BinHeap_Free(&s_explosions);
+	TimerWheel_Free(&s_explosions);
 }
 
 /**
@@ -291,15 +356,22 @@ void Explosion_Start(uint16 explosionType, tile32 position)
 	uint16 packed = Tile_PackTile(position);
 	Explosion_StopAtPosition(packed);
 
-	Explosion* e = (Explosion*)BinHeap_Push(&s_explosions, Timer_GetTicks());
-	if (e != NULL)
+	const int handle = TimerWheel_Alloc(&s_explosions);
+	if (handle != TIMERWHEEL_INVALID)
 	{
+		Explosion* e = Explosion_Get(handle);
+
+		e->timeOut = g_timerGame;
+		e->handle = handle;
 		e->commands = g_table_explosion[explosionType];
 		e->current = 0;
 		e->spriteID = SHAPE_INVALID;
 		e->position = position;
 		e->isDirty = false;
 
+		Explosion_LinkTile(e);
+		TimerWheel_Schedule(&s_explosions, handle, e->timeOut);
+
 		g_map[packed].hasExplosion = true;
 
 		/* Do not unveil for explosion types 13 (sandworm eat) and 19 (spice bloom). */
@@ -320,11 +392,13 @@ void Explosion_Start(uint16 explosionType, tile32 position)
  */
 void Explosion_Tick()
 {
-	const int64_t curr_ticks = Timer_GetTicks();
+	const int64_t curr_ticks = g_timerGame;
 
-	Explosion* e = (Explosion*)BinHeap_GetMin(&s_explosions);
-	while ((e != NULL) && (e->timeOut <= curr_ticks))
+	int handle;
+	while ((handle = TimerWheel_PopDue(&s_explosions, curr_ticks)) != TIMERWHEEL_INVALID)
 	{
+		Explosion* e = Explosion_Get(handle);
+
 		while (e->commands != NULL)
 		{
 			uint16 parameter = e->commands[e->current].parameter;
@@ -372,39 +446,149 @@ void Explosion_Tick()
 				break;
 		}
 
-		/* Push explosion with updated time before pop. */
 		if (e->commands == NULL)
 		{
-			BinHeap_Pop(&s_explosions);
+			TimerWheel_Release(&s_explosions, handle);
 		}
 		else
 		{
-			BinHeap_UpdateMin(&s_explosions);
+			TimerWheel_Schedule(&s_explosions, handle, e->timeOut);
+		}
+	}
+}
+
+static bool Explosion_SaveOne(FILE* fp, void* elem)
+{
+	const Explosion* e = (const Explosion *)elem;
+	ExplosionSave es;
+
+	memset(&es, 0, sizeof(es));
+	es.timeOut = e->timeOut;
+	es.position = e->position;
+	es.type = -1;
+	es.spriteID = e->spriteID;
+	es.current = e->current;
+	es.isDirty = e->isDirty ? 1 : 0;
+
+	for (int i = 0; i < EXPLOSIONTYPE_MAX; i++)
+	{
+		if (e->commands == g_table_explosion[i])
+		{
+			es.type = i;
+			break;
 		}
+	}
+
+	for (int handle = e->tilePrev; handle != TIMERWHEEL_INVALID; handle = Explosion_Get(handle)->tilePrev)
+		es.tileDepth++;
 
-		e = (Explosion*)BinHeap_GetMin(&s_explosions);
+	return fwrite(&es, sizeof(es), 1, fp) == 1;
+}
+
+static bool Explosion_LoadOne(FILE* fp, void* elem, int handle)
+{
+	Explosion* e = (Explosion *)elem;
+	ExplosionSave es;
+
+	if (fread(&es, sizeof(es), 1, fp) != 1)
+		return false;
+	if (es.type >= EXPLOSIONTYPE_MAX)
+		return false;
+
+	e->timeOut = es.timeOut;
+	e->handle = handle;
+	e->isDirty = (es.isDirty != 0);
+	e->current = es.current;
+	e->spriteID = (ShapeID)es.spriteID;
+	e->commands = (es.type < 0) ? NULL : g_table_explosion[es.type];
+	e->position = es.position;
+
+	/* Linked to its tile once all are loaded; until then tileNext holds the depth, below TIMERWHEEL_INVALID. */
+	e->tileNext = TIMERWHEEL_INVALID - 1 - es.tileDepth;
+	e->tilePrev = TIMERWHEEL_INVALID;
+	s_explosionLoadDepth = max(s_explosionLoadDepth, es.tileDepth);
+	return true;
+}
+
+/**
+ * Save the running Explosions, in the order they are run in.
+ * @param fp The file to save to.
+ * @return True if and only if all bytes were written successful.
+ */
+bool Explosion_Save(FILE* fp)
+{
+	return TimerWheel_Save(&s_explosions, fp, &Explosion_SaveOne);
+}
+
+/**
+ * Replace the running Explosions with those saved by Explosion_Save. The
+ *  game tick has to be the one they were saved at.
+ * @param fp The file to load from.
+ * @return True if and only if all bytes were read successful.
+ */
+bool Explosion_Load(FILE* fp)
+{
+	s_explosionLoadDepth = 0;
+	memset(s_explosionByTile, 0xFF, sizeof(s_explosionByTile));
+
+	if (!TimerWheel_Load(&s_explosions, sizeof(Explosion), fp, &Explosion_LoadOne))
+	{
+		Explosion_Init();
+		return false;
+	}
+
+	/* Explosions are added at the front of the list of their tile, so the deepest go first. */
+	for (int depth = s_explosionLoadDepth; depth >= 0; depth--)
+	{
+		for (int handle = 0; handle < s_explosions.num_chunks * TIMERWHEEL_CHUNK_SIZE; handle++)
+		{
+			if (!TimerWheel_IsScheduled(&s_explosions, handle))
+				continue;
+
+			Explosion* e = Explosion_Get(handle);
+			if (e->tileNext == TIMERWHEEL_INVALID - 1 - depth)
+				Explosion_LinkTile(e);
+		}
 	}
+
+	return true;
 }
 
 void Explosion_Draw()
 {
-	for (int i = 1; i < s_explosions.num_elem; i++)
+	const WidgetInfo* wi = &g_table_gameWidgetInfo[GAME_WIDGET_VIEWPORT];
+	const int left = Tile_GetPackedX(g_viewportPosition) * TILE_SIZE + g_viewport_scrollOffsetX;
+	const int top = Tile_GetPackedY(g_viewportPosition) * TILE_SIZE + g_viewport_scrollOffsetY;
+
+	/* Only the tiles that can pass Map_IsPositionInViewport. */
+	const int x1 = max(0, (left - TILE_SIZE) / TILE_SIZE);
+	const int y1 = max(0, (top - TILE_SIZE) / TILE_SIZE);
+	const int x2 = min(MAP_SIZE_MAX - 1, (left + TILE_SIZE + wi->width) / TILE_SIZE);
+	const int y2 = min(MAP_SIZE_MAX - 1, (top + TILE_SIZE + wi->height) / TILE_SIZE);
+
+	for (int ty = y1; ty <= y2; ty++)
 	{
-		Explosion* e = (Explosion *)BinHeap_GetElem(&s_explosions, i);
+		for (int tx = x1; tx <= x2; tx++)
+		{
+			const uint16 packed = Tile_PackXY(tx, ty);
 
-		if (e->commands == NULL)
-			continue;
-		if (e->spriteID == SHAPE_INVALID)
-			continue;
+			if (!g_map[packed].isUnveiled)
+				continue;
 
-		const uint16 packed = Tile_PackTile(e->position);
-		if (!g_map[packed].isUnveiled)
-			continue;
+			for (int handle = s_explosionByTile[packed]; handle != TIMERWHEEL_INVALID;)
+			{
+				const Explosion* e = Explosion_Get(handle);
+				handle = e->tileNext;
+
+				if (e->spriteID == SHAPE_INVALID)
+					continue;
 
-		int x, y;
-		if (!Map_IsPositionInViewport(e->position, &x, &y))
-			continue;
+				int x, y;
+				if (!Map_IsPositionInViewport(e->position, &x, &y))
+					continue;
 
-		Shape_Draw(e->spriteID, x, y, (WindowID)2, 0xC000);
+				Shape_Draw(e->spriteID, x, y, (WindowID)2, 0xC000);
+			}
+		}
 	}
 }
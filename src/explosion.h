@@ -3,6 +3,8 @@
 #ifndef EXPLOSION_H
 #define EXPLOSION_H
 
+#include <stdio.h>
+
 /**
  * Types of Explosions available in the game.
  */
@@ -64,5 +66,7 @@ void Explosion_Uninit();
 void Explosion_Start(uint16 explosionType, tile32 position);
 void Explosion_Tick();
 void Explosion_Draw();
+bool Explosion_Save(FILE* fp);
+bool Explosion_Load(FILE* fp);
 
 #endif /* EXPLOSION_H */
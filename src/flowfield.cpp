@@ -0,0 +1,261 @@
+/** @file src/flowfield.cpp Flow field routines.
+ *
+ * A flow field holds, for every tile of the map, the direction to take to
+ *  reach one destination as fast as possible with one movement type. It is
+ *  computed once, with a Dijkstra search outwards from the destination, and
+ *  then shared by every unit of a group order heading there. The cost of
+ *  moving a group thus no longer depends on the size of the group.
+ *
+ * The field only considers the landscape and structures. Other units are
+ *  checked when a route is taken from it, and a unit that is blocked falls
+ *  back to the regular pathfinder. A field is rebuilt when it is used
+ *  after g_mapRevision changed.
+ */
+
+#include <cassert>
+#include <cstring>
+#include "types.h"
+
+#include "flowfield.h"
+#include "map.h"
+#include "tools/coord.h"
+#include "unit.h"
+
+enum
+{
+	FLOWFIELD_CACHE_SIZE = 8,
+	FLOWFIELD_NONE = 0xFF
+};
+
+typedef struct FlowField
+{
+	bool used; /*!< If true, this slot holds a field. */
+	uint16 packedDst; /*!< The destination of the field. */
+	uint8 movementType; /*!< The movement type the field is for. */
+	uint32 lastUsed; /*!< When the field was last used, for eviction. */
+	uint32 revision; /*!< The g_mapRevision the field was computed for. */
+	uint8 speed[MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Movement speed per tile the field was computed with; 0 if impassable. */
+	uint8 direction[MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Direction to move in per tile, or FLOWFIELD_NONE. */
+} FlowField;
+
+static const int8 s_flowFieldDX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int8 s_flowFieldDY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+static const int16 s_mapDirection[8] = {-64, -63, 1, 65, 64, 63, -1, -65}; /*!< Tile index change when moving in a direction. */
+
+static FlowField s_flowField[FLOWFIELD_CACHE_SIZE];
+static uint32 s_flowFieldClock;
+
+/* Scratch space for building a field. */
+static uint32 s_integration[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint32 s_heap[MAP_SIZE_MAX * MAP_SIZE_MAX * 8];
+
+void FlowField_Init()
+{
+	for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++)
+		s_flowField[i].used = false;
+
+	s_flowFieldClock = 0;
+}
+
+static uint8 FlowField_GetTileSpeed(uint16 packed, uint8 movementType)
+{
+	if (!Map_IsValidPosition(packed) || g_map[packed].hasStructure)
+		return 0;
+
+	return g_table_landscapeInfo[Map_GetLandscapeType(packed)].movementSpeed[movementType];
+}
+
+/**
+ * Get the cost of entering a tile; the time it takes to cross it.
+ */
+static uint32 FlowField_GetStepCost(uint8 speed, uint8 direction)
+{
+	return ((direction & 0x1) != 0 ? 181 : 128) * 64 / speed;
+}
+
+/* Heap entries are the integration value in the upper 20 bits, and the tile in the lower 12 bits.
+ *  The integration value of a route over every tile of the map still fits. */
+static void FlowField_HeapPush(int* size, uint32 cost, uint16 packed)
+{
+	uint32 entry = (cost << 12) | packed;
+	int i = (*size)++;
+
+	while (i > 0)
+	{
+		const int parent = (i - 1) / 2;
+
+		if (s_heap[parent] <= entry)
+			break;
+
+		s_heap[i] = s_heap[parent];
+		i = parent;
+	}
+
+	s_heap[i] = entry;
+}
+
+static uint32 FlowField_HeapPop(int* size)
+{
+	const uint32 top = s_heap[0];
+	const uint32 last = s_heap[--(*size)];
+	int i = 0;
+
+	while (true)
+	{
+		int child = 2 * i + 1;
+
+		if (child >= *size)
+			break;
+
+		if (child + 1 < *size && s_heap[child + 1] < s_heap[child])
+			child++;
+
+		if (last <= s_heap[child])
+			break;
+
+		s_heap[i] = s_heap[child];
+		i = child;
+	}
+
+	s_heap[i] = last;
+	return top;
+}
+
+static void FlowField_Build(FlowField* ff)
+{
+	int size = 0;
+
+	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++)
+		ff->speed[packed] = FlowField_GetTileSpeed(packed, ff->movementType);
+
+	memset(ff->direction, FLOWFIELD_NONE, sizeof(ff->direction));
+	memset(s_integration, 0xFF, sizeof(s_integration));
+
+	ff->revision = g_mapRevision;
+
+	if (ff->speed[ff->packedDst] == 0)
+		return;
+
+	s_integration[ff->packedDst] = 0;
+	FlowField_HeapPush(&size, 0, ff->packedDst);
+
+	while (size > 0)
+	{
+		const uint32 entry = FlowField_HeapPop(&size);
+		const uint16 packed = entry & 0xFFF;
+		const uint32 cost = entry >> 12;
+
+		if (cost != s_integration[packed])
+			continue;
+
+		const int x = Tile_GetPackedX(packed);
+		const int y = Tile_GetPackedY(packed);
+
+		/* Look at the neighbours that can move into this tile. */
+		for (uint8 dir = 0; dir < 8; dir++)
+		{
+			const int nx = x - s_flowFieldDX[dir];
+			const int ny = y - s_flowFieldDY[dir];
+
+			if (nx < 0 || nx >= MAP_SIZE_MAX || ny < 0 || ny >= MAP_SIZE_MAX)
+				continue;
+
+			const uint16 neighbour = Tile_PackXY(nx, ny);
+
+			if (ff->speed[neighbour] == 0)
+				continue;
+
+			const uint32 newCost = cost + FlowField_GetStepCost(ff->speed[packed], dir);
+			if (newCost >= s_integration[neighbour])
+				continue;
+
+			s_integration[neighbour] = newCost;
+			ff->direction[neighbour] = dir;
+			FlowField_HeapPush(&size, newCost, neighbour);
+		}
+	}
+}
+
+static FlowField* FlowField_Get(uint16 packedDst, uint8 movementType)
+{
+	FlowField* ff = NULL;
+
+	for (int i = 0; i < FLOWFIELD_CACHE_SIZE; i++)
+	{
+		FlowField* f = &s_flowField[i];
+
+		if (f->used && f->packedDst == packedDst && f->movementType == movementType)
+		{
+			ff = f;
+			break;
+		}
+
+		/* Otherwise replace an empty or the least recently used field. */
+		if (ff == NULL || (ff->used && (!f->used || f->lastUsed < ff->lastUsed)))
+			ff = f;
+	}
+
+	if (!ff->used || ff->packedDst != packedDst || ff->movementType != movementType)
+	{
+		ff->used = true;
+		ff->packedDst = packedDst;
+		ff->movementType = movementType;
+		FlowField_Build(ff);
+	}
+	else if (ff->revision != g_mapRevision)
+	{
+		FlowField_Build(ff);
+	}
+
+	ff->lastUsed = ++s_flowFieldClock;
+	return ff;
+}
+
+/**
+ * Get a route for a unit by following the flow field towards a destination.
+ *
+ * @param unit The unit to get the route for.
+ * @param packedSrc Where the unit is.
+ * @param packedDst The destination.
+ * @param route Where to store the route; terminated by 0xFF if shorter than routeSize.
+ * @param routeSize The maximum length of the route.
+ * @return False if no route could be taken from the field.
+ */
+bool FlowField_GetRoute(Unit* unit, uint16 packedSrc, uint16 packedDst, uint8* route, int routeSize)
+{
+	const uint8 movementType = g_table_unitInfo[unit->o.type].movementType;
+	uint16 packed = packedSrc;
+	int length = 0;
+
+	assert(packedSrc < MAP_SIZE_MAX * MAP_SIZE_MAX && packedDst < MAP_SIZE_MAX * MAP_SIZE_MAX);
+
+	/* Aircraft and sandworms do not use routes over the landscape. */
+	if (movementType == MOVEMENT_WINGER || movementType == MOVEMENT_SLITHER)
+		return false;
+
+	const FlowField* ff = FlowField_Get(packedDst, movementType);
+
+	while (length < routeSize && packed != packedDst)
+	{
+		const uint8 dir = ff->direction[packed];
+
+		if (dir == FLOWFIELD_NONE)
+			break;
+
+		/* Other units are not part of the field; stop in front of them. */
+		const int16 score = Unit_GetTileEnterScore(unit, packed + s_mapDirection[dir], dir << 5);
+		if (score == -1 || score > 255)
+			break;
+
+		route[length++] = dir;
+		packed += s_mapDirection[dir];
+	}
+
+	if (length == 0)
+		return false;
+
+	if (length < routeSize)
+		route[length] = 0xFF;
+
+	return true;
+}
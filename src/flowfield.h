@@ -0,0 +1,13 @@
+/** @file src/flowfield.h Flow field definitions. */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "types.h"
+
+struct Unit;
+
+void FlowField_Init();
+bool FlowField_GetRoute(struct Unit* unit, uint16 packedSrc, uint16 packedDst, uint8* route, int routeSize);
+
+#endif /* FLOWFIELD_H */
@@ -11,6 +11,7 @@
 #include "house.h"
 #include "opendune.h"
 #include "sprites.h"
+#include "video/blit.h"
 #include "video/video.h"
 
 int TRUE_DISPLAY_WIDTH = 640;
@@ -364,12 +365,7 @@ void GFX_Screen_Copy2(int16 xSrc, int16 ySrc, int16 xDst, int16 yDst, int16 widt
 	{
 		if (skipNull)
 		{
-			uint16 i;
-			for (i = 0; i < width; i++)
-			{
-				if (src[i] != 0)
-					dst[i] = src[i];
-			}
+			Blit_CopyMasked(dst, src, width);
 		}
 		else
 		{
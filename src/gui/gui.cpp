@@ -43,6 +43,7 @@
 #include "../timer/timer.h"
 #include "../tools/random_lcg.h"
 #include "../unit.h"
+#include "../video/blit.h"
 #include "../video/video.h"
 
 static uint8 g_colours[16];
@@ -311,6 +312,126 @@ void GUI_DrawChar(unsigned char c, int x, int y)
 	}
 }
 
+/** A string laid out by GUI_DrawText, kept so the same text is not measured every frame. */
+struct TextLayout
+{
+	const Font* font;                   /*!< Font the string was measured with. */
+	int8 charOffset;                    /*!< #g_fontCharOffset it was measured with. */
+	int16 left;                         /*!< Left of the string. */
+	int16 top;                          /*!< Top of the string. */
+	int displayWidth;                   /*!< Display size lines were wrapped against. */
+	int displayHeight;
+	char string[256];                   /*!< The string, empty for an unused entry. */
+
+	uint16 count;                       /*!< Number of glyphs. */
+	uint8 chars[256];                   /*!< The glyphs. */
+	int16 x[256];                       /*!< Position of each glyph. */
+	int16 y[256];
+};
+
+static TextLayout s_textLayout[32];
+
+/**
+ * Lay out a string the way GUI_DrawText draws it, as far as the glyphs
+ *  fit in the layout.
+ *
+ * @param layout The layout to fill.
+ * @param s The string.
+ * @param left The most left position of the string.
+ * @param x The position of the next glyph, updated.
+ * @param y The position of the next glyph, updated.
+ * @return The rest of the string, or NULL if it was laid out completely.
+ */
+static const char* GUI_Text_Layout(TextLayout* layout, const char* s, int left, int* x, int* y)
+{
+	layout->count = 0;
+
+	while (*s != '\0')
+	{
+		uint16 width;
+
+		if (*s == '\n' || *s == '\r')
+		{
+			*x = left;
+			*y += g_fontCurrent->height;
+
+			while (*s == '\n' || *s == '\r')
+				s++;
+
+			if (*s == '\0')
+				break;
+		}
+
+		width = Font_GetCharWidth(*s);
+
+		if (*x + width > TRUE_DISPLAY_WIDTH)
+		{
+			*x = left;
+			*y += g_fontCurrent->height;
+		}
+		if (*y > TRUE_DISPLAY_HEIGHT)
+			break;
+
+		if (layout->count >= lengthof(layout->chars))
+			return s;
+
+		layout->chars[layout->count] = *s;
+		layout->x[layout->count] = *x;
+		layout->y[layout->count] = *y;
+		layout->count++;
+
+		*x += width;
+		s++;
+	}
+
+	return NULL;
+}
+
+/**
+ * Find the cached layout of a string, laying it out if it is not cached.
+ *
+ * @param string The string.
+ * @param left The most left position of the string.
+ * @param top The most top position of the string.
+ * @return The layout, or NULL if the string is too long to cache.
+ */
+static const TextLayout* GUI_Text_GetLayout(const char* string, int16 left, int16 top)
+{
+	uint32 hash = 2166136261u;
+	size_t len;
+
+	for (len = 0; string[len] != '\0'; len++)
+		hash = (hash ^ (uint8)string[len]) * 16777619u;
+
+	if (len >= lengthof(s_textLayout[0].string))
+		return NULL;
+
+	hash = (hash ^ (uint16)left) * 16777619u;
+	hash = (hash ^ (uint16)top) * 16777619u;
+
+	TextLayout* layout = &s_textLayout[hash % lengthof(s_textLayout)];
+
+	if (layout->font == g_fontCurrent && layout->charOffset == g_fontCharOffset
+			&& layout->left == left && layout->top == top
+			&& layout->displayWidth == TRUE_DISPLAY_WIDTH && layout->displayHeight == TRUE_DISPLAY_HEIGHT
+			&& strcmp(layout->string, string) == 0)
+		return layout;
+
+	int x = left;
+	int y = top;
+
+	layout->font = g_fontCurrent;
+	layout->charOffset = g_fontCharOffset;
+	layout->left = left;
+	layout->top = top;
+	layout->displayWidth = TRUE_DISPLAY_WIDTH;
+	layout->displayHeight = TRUE_DISPLAY_HEIGHT;
+	memcpy(layout->string, string, len + 1);
+	GUI_Text_Layout(layout, string, left, &x, &y);
+
+	return layout;
+}
+
 /**
  * Draw a string to the screen.
  *
@@ -323,9 +444,6 @@ void GUI_DrawChar(unsigned char c, int x, int y)
 void GUI_DrawText(const char* string, int16 left, int16 top, uint8 fgColour, uint8 bgColour)
 {
 	uint8 colours[2];
-	int x;
-	uint16 y;
-	const char* s;
 
 	if (g_fontCurrent == NULL)
 		return;
@@ -342,42 +460,25 @@ void GUI_DrawText(const char* string, int16 left, int16 top, uint8 fgColour, uin
 
 	GUI_InitColors(colours, 0, 1);
 
-	s = string;
-	x = left;
-	y = top;
-
-	Video_HoldBitmapDrawing(true);
+	const TextLayout* layout = GUI_Text_GetLayout(string, left, top);
 
-	while (*s != '\0')
+	if (layout != NULL)
 	{
-		uint16 width;
-
-		if (*s == '\n' || *s == '\r')
-		{
-			x = left;
-			y += g_fontCurrent->height;
-
-			while (*s == '\n' || *s == '\r')
-				s++;
-		}
-
-		width = Font_GetCharWidth(*s);
-
-		if (x + width > TRUE_DISPLAY_WIDTH)
-		{
-			x = left;
-			y += g_fontCurrent->height;
-		}
-		if (y > TRUE_DISPLAY_HEIGHT)
-			break;
+		Video_DrawGlyphs(layout->chars, layout->x, layout->y, layout->count, g_colours);
+		return;
+	}
 
-		Video_DrawChar(*s, g_colours, x, y);
+	/* Too long to cache: lay out and draw the string in pieces. */
+	static TextLayout s_longText;
+	const char* s = string;
+	int x = left;
+	int y = top;
 
-		x += width;
-		s++;
+	while (s != NULL)
+	{
+		s = GUI_Text_Layout(&s_longText, s, left, &x, &y);
+		Video_DrawGlyphs(s_longText.chars, s_longText.x, s_longText.y, s_longText.count, g_colours);
 	}
-
-	Video_HoldBitmapDrawing(false);
 }
 
 /**
@@ -1921,13 +2022,8 @@ void GUI_Palette_RemapScreen(uint16 left, uint16 top, uint16 width, uint16 heigh
 	screen += top * SCREEN_WIDTH + left;
 	for (; height > 0; height--)
 	{
-		int i;
-		for (i = width; i > 0; i--)
-		{
-			uint8 pixel = *screen;
-			*screen++ = remap[pixel];
-		}
-		screen += SCREEN_WIDTH - width;
+		Blit_Remap(screen, width, remap);
+		screen += SCREEN_WIDTH;
 	}
 }
 
@@ -2361,8 +2457,6 @@ void GUI_DrawScreen(Screen screenID)
 	if (screenID != SCREEN_0)
 		g_viewport_forceRedraw = true;
 
-	Explosion_Tick();
-	Animation_Tick();
 	Unit_Sort();
 
 	Map_UpdateFogOfWar();
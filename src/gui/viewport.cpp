@@ -24,6 +24,53 @@
 #include "../unit.h"
 #include "../video/video.h"
 
+/** Layers of the units drawn in the viewport, bottom to top. */
+enum ViewportLayer
+{
+	VIEWPORT_LAYER_SANDWORM = 0,
+	VIEWPORT_LAYER_GROUND   = 1,
+	VIEWPORT_LAYER_AIR      = 2,
+
+	VIEWPORT_LAYER_MAX      = 3
+};
+
+static Unit* s_drawList[VIEWPORT_LAYER_MAX][UNIT_INDEX_MAX]; /*!< Units to draw this frame, per layer. */
+static uint16 s_drawListCount[VIEWPORT_LAYER_MAX];
+
+/**
+ * Build the draw list with one walk over the units, which Unit_Sort()
+ *  keeps in the order they are drawn. Ground units are only kept if
+ *  they are in the viewport; sandworms (drawn with their trail) and air
+ *  units (drawn between two positions) are few and kept.
+ */
+static void Viewport_BuildDrawList()
+{
+	memset(s_drawListCount, 0, sizeof(s_drawListCount));
+
+	for (uint16 i = 0; i < g_unitSortCount; i++)
+	{
+		Unit* u = g_unitSortArray[i];
+		ViewportLayer layer;
+
+		if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		if (u->o.type == UNIT_SANDWORM)
+			layer = VIEWPORT_LAYER_SANDWORM;
+		else if (UNIT_INDEX_SABOTEUR_START <= u->o.index && u->o.index <= UNIT_INDEX_NORMAL_END)
+			layer = VIEWPORT_LAYER_GROUND;
+		else if (u->o.index <= UNIT_INDEX_PROJECTILE_END)
+			layer = VIEWPORT_LAYER_AIR;
+		else
+			continue;
+
+		if (layer == VIEWPORT_LAYER_GROUND && !Map_IsPositionInViewport(u->o.position, NULL, NULL))
+			continue;
+
+		s_drawList[layer][s_drawListCount[layer]++] = u;
+	}
+}
+
 /**
  * Redraw parts of the viewport that require redrawing.
  *
@@ -42,8 +89,6 @@ void GUI_Widget_Viewport_Draw(bool forceRedraw, bool arg08, bool drawToMainScree
 	int16 minX[10];
 	int16 maxX[10];
 
-	PoolFindStruct find;
-
 	updateDisplay = forceRedraw;
 
 	memset(minX, 0xF, sizeof(minX));
@@ -54,19 +99,10 @@ void GUI_Widget_Viewport_Draw(bool forceRedraw, bool arg08, bool drawToMainScree
 	oldValue_07AE_0000 = Widget_SetCurrentWidget(2);
 
 	Viewport_DrawTiles();
+	Viewport_BuildDrawList();
 
-	{
-		find.type = UNIT_SANDWORM;
-		find.index = 0xFFFF;
-		find.houseID = HOUSE_INVALID;
-
-		Unit* u = Unit_Find(&find);
-		while (u != NULL)
-		{
-			Viewport_DrawSandworm(u);
-			u = Unit_Find(&find);
-		}
-	}
+	for (uint16 j = 0; j < s_drawListCount[VIEWPORT_LAYER_SANDWORM]; j++)
+		Viewport_DrawSandworm(s_drawList[VIEWPORT_LAYER_SANDWORM][j]);
 
 	/* Draw selected unit under units. */
 	if ((g_selectionType != SELECTIONTYPE_PLACE) && !Unit_AnySelected() && (Structure_Get_ByPackedTile(g_selectionRectanglePosition) != NULL))
@@ -79,18 +115,8 @@ void GUI_Widget_Viewport_Draw(bool forceRedraw, bool arg08, bool drawToMainScree
 		Prim_Rect_i(x1, y1, x2, y2, 0xFF);
 	}
 
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-	find.houseID = HOUSE_INVALID;
-
-	Unit* u = Unit_Find(&find);
-	while (u != NULL)
-	{
-		if ((UNIT_INDEX_SABOTEUR_START <= u->o.index && u->o.index <= UNIT_INDEX_NORMAL_END))
-			Viewport_DrawUnit(u, 0, 0, false);
-
-		u = Unit_Find(&find);
-	}
+	for (uint16 j = 0; j < s_drawListCount[VIEWPORT_LAYER_GROUND]; j++)
+		Viewport_DrawUnit(s_drawList[VIEWPORT_LAYER_GROUND][j], 0, 0, false);
 
 	Explosion_Draw();
 	Viewport_DrawTileFog();
@@ -119,18 +145,8 @@ void GUI_Widget_Viewport_Draw(bool forceRedraw, bool arg08, bool drawToMainScree
 		}
 	}
 
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-	find.houseID = HOUSE_INVALID;
-
-	u = Unit_Find(&find);
-	while (u != NULL)
-	{
-		if (u->o.index <= UNIT_INDEX_PROJECTILE_END)
-			Viewport_DrawAirUnit(u);
-
-		u = Unit_Find(&find);
-	}
+	for (uint16 j = 0; j < s_drawListCount[VIEWPORT_LAYER_AIR]; j++)
+		Viewport_DrawAirUnit(s_drawList[VIEWPORT_LAYER_AIR][j]);
 
 	if ((g_viewportMessageCounter & 1) != 0 && g_viewportMessageText != NULL && (minX[6] <= 14 || maxX[6] >= 0 || arg08 || forceRedraw))
 	{
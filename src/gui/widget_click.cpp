@@ -237,28 +237,7 @@ bool GUI_Widget_Cancel_Click(Widget* w)
 	UNUSED(w);
 
 	if (g_structureActiveType != 0xFFFF)
-	{
-		Structure* s = Structure_Get_ByPackedTile(g_structureActivePosition);
-		Structure* s2 = g_structureActive;
-
-		assert(s2 != NULL);
-
-		if (s != NULL)
-		{
-			s->o.linkedID = s2->o.index;
-		}
-		else
-		{
-			Structure_Free(s2);
-		}
-
-		g_structureActive = NULL;
-		g_structureActiveType = 0xFFFF;
-
-		GUI_ChangeSelectionType(SELECTIONTYPE_STRUCTURE);
-
-		g_selectionState = 0; /* Invalid. */
-	}
+		ActionPanel_CancelPlacement();
 
 	if (g_unitActive == NULL)
 		return true;
@@ -1,6 +1,8 @@
 /** @file src/house.c %House management routines. */
 
+#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include "enum_string.h"
 #include "os/math.h"
 #include "os/sleep.h"
@@ -456,50 +458,104 @@ bool House_UpdateRadarState(House* h)
 }
 
 /**
- * Update the CreditsStorage by walking over all structures and checking what
- *  they can hold.
- * @param houseID The house to check the storage for.
+ * Get the power a Structure produces, given its current hitpoints.
+ * @param s The Structure.
+ * @return The power produced, or 0 for Structures that use power.
  */
-void House_UpdateCreditsStorage(uint8 houseID)
+static uint16 House_GetStructurePowerProduction(const Structure* s)
 {
-	PoolFindStruct find;
-	uint32 creditsStorage;
+	const StructureInfo* si = &g_table_structureInfo[s->o.type];
 
-	uint16 oldValidateStrictIfZero = g_validateStrictIfZero;
-	g_validateStrictIfZero = 0;
+	/* Positive values means usage */
+	if (si->powerUsage >= 0)
+		return 0;
 
-	find.houseID = houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
+	/* Negative value and full health means everything goes to production */
+	if (s->o.hitpoints >= si->o.hitpoints)
+		return -si->powerUsage;
 
-	creditsStorage = 0;
-	while (true)
-	{
-		const StructureInfo* si;
-		Structure* s;
+	return (-si->powerUsage) * s->o.hitpoints / si->o.hitpoints;
+}
 
-		s = Structure_Find(&find);
-		if (s == NULL)
-			break;
+/**
+ * Add a placed Structure to the power, storage and structures built totals
+ *  of its House. Does nothing if it is already included.
+ * @param s The Structure.
+ */
+void House_AddStructure(Structure* s)
+{
+	if (s == NULL || s->isAccounted || s->o.flags.s.isNotOnMap)
+		return;
 
-		si = &g_table_structureInfo[s->o.type];
-		creditsStorage += si->creditsStorage;
-	}
+	const StructureInfo* si = &g_table_structureInfo[s->o.type];
+	House* h = House_Get_ByIndex(s->o.houseID);
+
+	s->isAccounted = true;
+	s->accountedPowerProduction = House_GetStructurePowerProduction(s);
 
-	if (creditsStorage > 32000)
-		creditsStorage = 32000;
+	h->creditsStorage += si->creditsStorage;
+	h->powerProduction += s->accountedPowerProduction;
 
-	House_Get_ByIndex(houseID)->creditsStorage = creditsStorage;
+	if (si->powerUsage >= 0)
+		h->powerUsage += si->powerUsage;
 
-	g_validateStrictIfZero = oldValidateStrictIfZero;
+	if (h->structureCount[s->o.type]++ == 0)
+		h->structuresBuilt |= 1 << s->o.type;
+
+	h->windtrapCount = h->structureCount[STRUCTURE_WINDTRAP];
 }
 
 /**
- * Calculate the power usage and production, and the credits storage.
- *
- * @param h The house to calculate the numbers for.
+ * Remove a Structure from the totals of its House. Must be called before the
+ *  Structure changes owner or is freed.
+ * @param s The Structure.
  */
-void House_CalculatePowerAndCredit(House* h)
+void House_RemoveStructure(Structure* s)
+{
+	if (s == NULL || !s->isAccounted)
+		return;
+
+	const StructureInfo* si = &g_table_structureInfo[s->o.type];
+	House* h = House_Get_ByIndex(s->o.houseID);
+
+	s->isAccounted = false;
+
+	h->creditsStorage -= si->creditsStorage;
+	h->powerProduction -= s->accountedPowerProduction;
+
+	if (si->powerUsage >= 0)
+		h->powerUsage -= si->powerUsage;
+
+	assert(h->structureCount[s->o.type] != 0);
+	if (--h->structureCount[s->o.type] == 0)
+		h->structuresBuilt &= ~(1 << s->o.type);
+
+	h->windtrapCount = h->structureCount[STRUCTURE_WINDTRAP];
+}
+
+/**
+ * Update the totals of the House of a Structure after its hitpoints changed.
+ * @param s The Structure.
+ */
+void House_UpdateStructure(Structure* s)
+{
+	if (s == NULL || !s->isAccounted)
+		return;
+
+	const uint16 powerProduction = House_GetStructurePowerProduction(s);
+	House* h = House_Get_ByIndex(s->o.houseID);
+
+	h->powerProduction += powerProduction - s->accountedPowerProduction;
+	s->accountedPowerProduction = powerProduction;
+}
+
+/**
+ * Rebuild the structure totals of a House by walking over all its
+ *  structures. Only needed when Structures are not placed one by one, like
+ *  after loading a savegame.
+ * @param h The House to recount.
+ */
+void House_RecountStructures(House* h)
 {
 	PoolFindStruct find;
 
@@ -509,6 +565,37 @@ void House_CalculatePowerAndCredit(House* h)
 	h->powerUsage = 0;
 	h->powerProduction = 0;
 	h->creditsStorage = 0;
+	h->structuresBuilt = 0;
+	h->windtrapCount = 0;
+	memset(h->structureCount, 0, sizeof(h->structureCount));
+
+	find.houseID = h->index;
+	find.index = 0xFFFF;
+	find.type = 0xFFFF;
+
+	while (true)
+	{
+		Structure* s = Structure_Find(&find);
+		if (s == NULL)
+			break;
+
+		s->isAccounted = false;
+		House_AddStructure(s);
+	}
+}
+
+#ifdef DEBUG
+/**
+ * Check the incrementally kept totals of a House against a full recount.
+ * @param h The House to check.
+ */
+static void House_ValidateStructureTotals(House* h)
+{
+	PoolFindStruct find;
+	uint16 powerUsage = 0;
+	uint16 powerProduction = 0;
+	uint16 creditsStorage = 0;
+	uint32 structuresBuilt = 0;
 
 	find.houseID = h->index;
 	find.index = 0xFFFF;
@@ -529,24 +616,36 @@ void House_CalculatePowerAndCredit(House* h)
 
 		si = &g_table_structureInfo[s->o.type];
 
-		h->creditsStorage += si->creditsStorage;
+		creditsStorage += si->creditsStorage;
+		powerProduction += House_GetStructurePowerProduction(s);
+		structuresBuilt |= 1 << s->o.type;
 
-		/* Positive values means usage */
 		if (si->powerUsage >= 0)
-		{
-			h->powerUsage += si->powerUsage;
-			continue;
-		}
+			powerUsage += si->powerUsage;
+	}
 
-		/* Negative value and full health means everything goes to production */
-		if (s->o.hitpoints >= si->o.hitpoints)
-		{
-			h->powerProduction += -si->powerUsage;
-			continue;
-		}
+	assert(h->powerUsage == powerUsage);
+	assert(h->powerProduction == powerProduction);
+	assert(h->creditsStorage == creditsStorage);
+	assert(h->structuresBuilt == structuresBuilt);
+}
+#endif
 
-		h->powerProduction += (-si->powerUsage) * s->o.hitpoints / si->o.hitpoints;
-	}
+/**
+ * React to the power usage and production, and the credits storage of a
+ *  House. The numbers themselves are kept up to date by House_AddStructure
+ *  and friends; debug builds check them against a full recount here.
+ *
+ * @param h The house to check the numbers for.
+ */
+void House_CalculatePowerAndCredit(House* h)
+{
+	if (h == NULL)
+		return;
+
+#ifdef DEBUG
+	House_ValidateStructureTotals(h);
+#endif
 
 	/* Check if we are low on power */
 	if (h->index == g_playerHouseID && h->powerUsage > h->powerProduction)
@@ -52,6 +52,7 @@ struct House
 	uint16 powerProduction; /*!< Amount of power the House produces. */
 	uint16 powerUsage; /*!< Amount of power the House requires. */
 	uint16 windtrapCount; /*!< Amount of windtraps the House currently has. */
+	uint16 structureCount[STRUCTURE_MAX]; /*!< Amount of placed Structures per type, backing structuresBuilt. */
 	uint16 creditsQuota; /*!< Quota house has to reach to win the mission. */
 	tile32 palacePosition; /*!< Position of the Palace. */
 	uint16 timerUnitAttack; /*!< Timer to count down when next 'unit approaching' message can be showed again. */
@@ -150,7 +151,10 @@ uint8 House_StringToType(const char* name);
 void House_EnsureHarvesterAvailable(uint8 houseID);
 bool House_AreAllied(uint8 houseID1, uint8 houseID2);
 bool House_UpdateRadarState(House* h);
-void House_UpdateCreditsStorage(uint8 houseID);
+void House_AddStructure(struct Structure* s);
+void House_RemoveStructure(struct Structure* s);
+void House_UpdateStructure(struct Structure* s);
+void House_RecountStructures(struct House* h);
 void House_CalculatePowerAndCredit(struct House* h);
 const char* House_GetWSAHouseFilename(uint8 houseID);
 
@@ -35,6 +35,8 @@ enum
 	CC_DDM2 = FOURCC('D','D','M','2'), /* Dune Dynasty Map 2 (fog of war). */
 	CC_DDS2 = FOURCC('D','D','S','2'), /* Dune Dynasty Scenario 2 (alliances). */
 	CC_DDU2 = FOURCC('D','D','U','2'), /* Dune Dynasty Unit 2. */
+	CC_DDRP = FOURCC('D','D','R','P'), /* Dune Dynasty Replay. */
+	CC_DDBL = FOURCC('D','D','B','L'), /* Dune Dynasty Balance. */
 };
 
 #undef FOURCC
@@ -30,5 +30,6 @@ Scancode Input_GetNextKey();
 #include "input_a5.h"
 
 #define Input_Tick  InputA5_Tick
+#define Input_HasEvents  InputA5_HasEvents
 
 #endif
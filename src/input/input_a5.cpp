@@ -191,3 +191,8 @@ bool InputA5_Tick(bool apply_mouse_transform)
 
 	return redraw;
 }
+
+bool InputA5_HasEvents()
+{
+	return !al_is_event_queue_empty(g_a5_input_queue);
+}
@@ -7,5 +7,6 @@ extern bool InputA5_Init();
 void InputA5_Uninit();
 extern bool InputA5_ProcessEvent(union ALLEGRO_EVENT* event, bool apply_mouse_transform);
 extern bool InputA5_Tick(bool apply_mouse_transform);
+bool InputA5_HasEvents();
 
 #endif
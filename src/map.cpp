@@ -44,11 +44,17 @@ uint16 g_mapSpriteID[MAP_SIZE_MAX * MAP_SIZE_MAX];
  */
 Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
-
-const uint8 g_functions[3][3] = {{0, 1, 0}, {2, 3, 0}, {0, 1, 0}};
+uint32 g_mapRevision = 0; /*!< Increased whenever the movement speed of a tile may have changed, or a structure was built or removed. */
 
 static bool s_debugNoExplosionDamage = false; /*!< When non-zero, explosions do no damage to their surrounding. */
 
+/* Spice index: per row, a bit for every tile that may hold spice or thick spice.
+ * Kept up to date by Map_ChangeSpiceAmount, and rebuilt after the map is
+ *  replaced as a whole. Map_SearchSpice only looks at tiles with their bit set.
+ */
+static uint64_t s_spiceRows[MAP_SIZE_MAX];
+static bool s_spiceRowsValid = false;
+
 /**
  * Map definitions.
  * Map sizes: [0] is 62x62, [1] is 32x32, [2] is 21x21.
@@ -665,6 +671,8 @@ void Map_Bloom_ExplodeSpice(uint16 packed, uint8 houseID)
 	{
 		Unit_Remove(Unit_Get_ByPackedTile(packed));
 		g_map[packed].groundSpriteID = g_mapSpriteID[packed] & 0x1FF;
+		g_mapRevision++;
+		Structure_InvalidateBuildIndex(packed);
 		Map_MakeExplosion(EXPLOSION_SPICE_BLOOM_TREMOR, Tile_UnpackTile(packed), 0, 0);
 	}
 
@@ -781,12 +789,14 @@ static void Map_FixupSpiceEdges(uint16 packed)
 void Map_ChangeSpiceAmount(uint16 packed, int16 dir)
 {
 	uint16 type;
+	uint16 oldType;
 	uint16 spriteID;
 
 	if (dir == 0)
 		return;
 
 	type = Map_GetLandscapeType(packed);
+	oldType = type;
 
 	if (type == LST_THICK_SPICE && dir > 0)
 		return;
@@ -813,6 +823,16 @@ void Map_ChangeSpiceAmount(uint16 packed, int16 dir)
 	spriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE] + spriteID] & 0x1FF;
 	g_mapSpriteID[packed] = 0x8000 | spriteID;
 	g_map[packed].groundSpriteID = spriteID;
+	Structure_InvalidateBuildIndex(packed);
+
+	/* Spice and thick spice cost the same to cross, so only sand <-> spice changes a route */
+	if (memcmp(g_table_landscapeInfo[oldType].movementSpeed, g_table_landscapeInfo[type].movementSpeed, sizeof(g_table_landscapeInfo[type].movementSpeed)) != 0)
+		g_mapRevision++;
+
+	if (type == LST_NORMAL_SAND)
+		s_spiceRows[Tile_GetPackedY(packed)] &= ~((uint64_t)1 << Tile_GetPackedX(packed));
+	else
+		s_spiceRows[Tile_GetPackedY(packed)] |= (uint64_t)1 << Tile_GetPackedX(packed);
 
 	Map_FixupSpiceEdges(packed);
 	Map_FixupSpiceEdges(packed + 1);
@@ -837,6 +857,8 @@ void Map_Bloom_ExplodeSpecial(uint16 packed, uint8 houseID)
 
 	g_map[packed].groundSpriteID = g_landscapeSpriteID;
 	g_mapSpriteID[packed] = 0x8000 | g_landscapeSpriteID;
+	g_mapRevision++;
+	Structure_InvalidateBuildIndex(packed);
 
 	Map_Update(packed, 0, false);
 
@@ -1160,6 +1182,56 @@ void Map_UpdateAround(uint16 radius, tile32 position, Unit* unit, uint8 function
 	while ((diff.x != 0) || (diff.y != 0));
 }
 
+/**
+ * Mark the spice index as outdated, after the map was replaced as a whole.
+ *  It is rebuilt on the next spice search.
+ */
+void Map_ResetSpiceIndex()
+{
+	s_spiceRowsValid = false;
+}
+
+static void Map_RebuildSpiceIndex()
+{
+	for (int y = 0; y < MAP_SIZE_MAX; y++)
+	{
+		uint64_t row = 0;
+
+		for (int x = 0; x < MAP_SIZE_MAX; x++)
+		{
+			const uint16 packed = Tile_PackXY(x, y);
+			const uint16 type = Map_GetLandscapeType(packed);
+			const LandscapeType original = Map_GetLandscapeTypeOriginal(packed);
+
+			/* Also include the original landscape, so tiles under an animation are not missed. */
+			if (type == LST_SPICE || type == LST_THICK_SPICE || original == LST_SPICE || original == LST_THICK_SPICE)
+				row |= (uint64_t)1 << x;
+		}
+
+		s_spiceRows[y] = row;
+	}
+
+	s_spiceRowsValid = true;
+}
+
+/**
+ * Get the index of the lowest bit set.
+ * @param bits The bits; must not be 0.
+ * @return The index of the lowest bit set.
+ */
+static int Map_LowestBit(uint64_t bits)
+{
+	/* De Bruijn sequence; avoids 64-bit intrinsics, which not all targets have. */
+	static const uint8 debruijn[64] = {
+		 0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+	};
+
+	return debruijn[((bits & (0 - bits)) * 0x03F79D71B4CB0A89ULL) >> 58];
+}
+
 /**
  * Search for spice around a position. Thick spice is preferred if it is not too far away.
  * @param packed Center position.
@@ -1195,10 +1267,19 @@ uint16 Map_SearchSpice(uint16 packed, uint16 radius)
 	ymin = max(Tile_GetPackedY(packed) - radius, mapInfo->minY);
 	ymax = min(Tile_GetPackedY(packed) + radius, mapInfo->minY + mapInfo->sizeY - 1);
 
+	if (!s_spiceRowsValid)
+		Map_RebuildSpiceIndex();
+
+	/* Bits xmin..xmax; xmax is at most 63. */
+	const uint64_t rangeMask = (((uint64_t)2 << xmax) - 1) & ~(((uint64_t)1 << xmin) - 1);
+
 	for (y = ymin; y <= ymax; y++)
 	{
-		for (x = xmin; x <= xmax; x++)
+		/* Visit the spice tiles of this row in increasing x, like a full scan would. */
+		for (uint64_t bits = s_spiceRows[y] & rangeMask; bits != 0; bits &= bits - 1)
 		{
+			x = Map_LowestBit(bits);
+
 			uint16 curPacked = Tile_PackXY(x, y);
 			uint16 type;
 			uint16 distance;
@@ -1875,4 +1956,7 @@ void Map_CreateLandscape(uint32 seed)
 
 	for (i = 0; i < MAP_SIZE_MAX * MAP_SIZE_MAX; i++)
 		g_mapSpriteID[i] = g_map[i].groundSpriteID;
+
+	g_mapRevision++;
+	Structure_ResetBuildIndex();
 }
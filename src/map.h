@@ -104,7 +104,7 @@ struct Unit;
 extern uint16 g_mapSpriteID[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
-extern const uint8 g_functions[3][3];
+extern uint32 g_mapRevision;
 
 extern const MapInfo g_mapInfos[3];
 
@@ -135,6 +135,7 @@ void Map_ChangeSpiceAmount(uint16 packed, int16 dir);
 void Map_Bloom_ExplodeSpecial(uint16 packed, uint8 houseID);
 uint16 Map_FindLocationTile(uint16 locationID, uint8 houseID);
 void Map_UpdateAround(uint16 arg06, tile32 position, struct Unit* unit, uint8 function);
+void Map_ResetSpiceIndex();
 uint16 Map_SearchSpice(uint16 packed, uint16 radius);
 bool Map_UnveilTile(uint16 packed, uint8 houseID);
 void Map_RefreshTile(uint16 packed);
@@ -21,6 +21,16 @@
 #include "../tools/random_general.h"
 #include "../tools/random_lcg.h"
 
+enum
+{
+	/* Smallest area kept as an island; smaller ones are filled in. */
+	SKIRMISH_ISLAND_MIN_AREA = 50,
+	SKIRMISH_ISLAND_MAX = MAP_SIZE_MAX * MAP_SIZE_MAX / SKIRMISH_ISLAND_MIN_AREA + 1,
+
+	/* Seeds tried per call to Skirmish_GenerateMap with a new seed. */
+	SKIRMISH_SEED_ATTEMPTS = 32
+};
+
 struct BuildableTile
 {
 	int x, y;
@@ -45,7 +55,7 @@ struct SkirmishData
 
 	int nislands;
 	int nislands_unused;
-	Island* island;
+	Island island[SKIRMISH_ISLAND_MAX];
 };
 
 struct SkirmishBuildOrder
@@ -347,7 +357,12 @@ static bool Skirmish_IsIslandEnclosed(int start, int end, const SkirmishData* sd
 	return true;
 }
 
-static void Skirmish_DivideIsland(HouseType houseID, int island, SkirmishData* sd)
+/**
+ * Flood-fill the remaining buildable tiles of an island into sub-islands.
+ *
+ * @return False if the island list is full, in which case the map is rejected.
+ */
+static bool Skirmish_DivideIsland(HouseType houseID, int island, SkirmishData* sd)
 {
 	int start = sd->island[island].start;
 	const int len = sd->island[island].end - sd->island[island].start;
@@ -358,10 +373,15 @@ static void Skirmish_DivideIsland(HouseType houseID, int island, SkirmishData* s
 	{
 		const int area = Skirmish_FindBuildableArea(island, orig[i].x, orig[i].y, sd, sd->buildable + start);
 
-		if (area >= 50)
+		if (area >= SKIRMISH_ISLAND_MIN_AREA)
 		{
-			sd->island = (Island*)realloc(sd->island, (sd->nislands + 1) * sizeof(sd->island[0]));
-			assert(sd->island != NULL);
+			/* Used islands stay in the list, so dividing them again can
+			 * exceed the number of disjoint islands the map can hold. */
+			if (sd->nislands >= SKIRMISH_ISLAND_MAX)
+			{
+				free(orig);
+				return false;
+			}
 
 			sd->island[sd->nislands].start = start;
 			sd->island[sd->nislands].end = start + area;
@@ -391,6 +411,7 @@ static void Skirmish_DivideIsland(HouseType houseID, int island, SkirmishData* s
 	sd->island[island].used = true;
 	sd->nislands_unused--;
 	free(orig);
+	return true;
 }
 
 static int Skirmish_BuildOrder_Sorter(const void* a, const void* b)
@@ -501,12 +522,14 @@ static bool Skirmish_GenStructuresAI(HouseType houseID, SkirmishData* sd)
 			const int r = Tools_RandomLCG_Range(0, range - 1);
 			const uint16 packed = sd->buildable[sd->island[island].start + r].packed;
 
-			if (Structure_IsValidBuildLandscape(packed, type) != 0)
+			/* The build index rejects most spots; the landscape check decides, so the bases of a seed stay the same. */
+			if (Structure_IsBuildable(packed, type) && Structure_IsValidBuildLandscape(packed, type) != 0)
 			{
 				Structure* s = Structure_Create(STRUCTURE_INDEX_INVALID, type, houseID, packed);
 				assert(s != NULL);
 
 				s->o.hitpoints = si->o.hitpoints;
+				House_UpdateStructure(s);
 				s->o.flags.s.degrades = false;
 				s->state = STRUCTURE_STATE_IDLE;
 
@@ -541,7 +564,7 @@ static bool Skirmish_GenStructuresAI(HouseType houseID, SkirmishData* sd)
 
 			const int parent = sd->island[island].start + sd->buildable[self].parent;
 			packed = sd->buildable[parent].packed;
-			if (Structure_IsValidBuildLandscape(packed, STRUCTURE_SLAB_1x1) == 0)
+			if (!Structure_IsBuildable(packed, STRUCTURE_SLAB_1x1) || Structure_IsValidBuildLandscape(packed, STRUCTURE_SLAB_1x1) == 0)
 				continue;
 
 			g_validateStrictIfZero++;
@@ -553,7 +576,8 @@ static bool Skirmish_GenStructuresAI(HouseType houseID, SkirmishData* sd)
 		 * remaining buildable tiles.
 		 */
 		g_validateStrictIfZero++;
-		Skirmish_DivideIsland(houseID, island, sd);
+		if (!Skirmish_DivideIsland(houseID, island, sd))
+			return false;
 
 		if (structure_count <= 0)
 			return true;
@@ -766,25 +790,24 @@ static void Skirmish_GenCHOAM()
 		g_starportAvailable[UNIT_SIEGE_TANK] = Tools_RandomLCG_Range(3, 5);
 }
 
-static bool Skirmish_GenerateMapInner(bool generate_houses, SkirmishData* sd)
+/**
+ * Create the landscape for the seed, and divide its buildable land into
+ *  islands. Only the map is touched, so a seed can be rejected without
+ *  setting up the rest of the game.
+ *
+ * @return False if there is no island large enough to build on.
+ */
+static bool Skirmish_GenerateLandscape(uint16 seed, SkirmishData* sd)
 {
 	const MapInfo* mi = &g_mapInfos[0];
 
-	if (generate_houses)
-		Skirmish_Prepare();
-
-	Game_Init();
-
-	Skirmish_GenGeneral();
-	Sprites_UnloadTiles();
-	Sprites_LoadTiles();
-	Tools_RandomLCG_Seed(g_skirmish.seed);
-	Map_CreateLandscape(g_skirmish.seed);
-
-	if (!generate_houses)
-		return true;
+	Tools_RandomLCG_Seed(seed);
+	Map_CreateLandscape(seed);
 
 	/* Create initial island. */
+	sd->nislands = 1;
+	sd->nislands_unused = 1;
+	sd->island[0].used = false;
 	sd->island[0].start = 0;
 	sd->island[0].end = 0;
 	for (int dy = 0; dy < mi->sizeY; dy++)
@@ -804,11 +827,18 @@ static bool Skirmish_GenerateMapInner(bool generate_houses, SkirmishData* sd)
 	}
 
 	memset(sd->islandID, 0, MAP_SIZE_MAX * MAP_SIZE_MAX * sizeof(sd->islandID[0]));
-	Skirmish_DivideIsland(HOUSE_INVALID, 0, sd);
-
-	if (sd->nislands_unused == 0)
+	if (!Skirmish_DivideIsland(HOUSE_INVALID, 0, sd))
 		return false;
 
+	return (sd->nislands_unused > 0);
+}
+
+/**
+ * Populate the map created by Skirmish_GenerateLandscape with the houses,
+ *  their structures and units.
+ */
+static bool Skirmish_GenerateMapInner(SkirmishData* sd)
+{
 	/* Spawn players. */
 	for (HouseType houseID = HOUSE_HARKONNEN; houseID < HOUSE_MAX; houseID++)
 	{
@@ -865,35 +895,59 @@ bool Skirmish_GenerateMap(bool newseed)
 	g_scenarioID = 0xFFFF;
 	g_validateStrictIfZero++;
 
-	if (newseed)
+	static SkirmishData sd;
+	bool ret = false;
+
+	/* The tiles and unit scripts may have been overwritten by the menu;
+	 * load them once for all the seeds tried.
+	 */
+	Sprites_UnloadTiles();
+	Sprites_LoadTiles();
+
+	g_generatingMap = true;
+
+	/* A seed rejected for its landscape only touched the map, which the
+	 * next landscape overwrites, so the game is only reset again after a
+	 * failed attempt to populate it.
+	 */
+	bool dirty = true;
+
+	for (int attempt = 0; attempt < (newseed ? SKIRMISH_SEED_ATTEMPTS : 1); attempt++)
 	{
 		/* DuneMaps only supports 15 bit maps seeds, so there. */
-		g_skirmish.seed = rand() & 0x7FFF;
-	}
+		if (newseed)
+			g_skirmish.seed = rand() & 0x7FFF;
 
-	SkirmishData sd;
+		if (dirty)
+		{
+			if (generate_houses)
+				Skirmish_Prepare();
 
-	if (generate_houses)
-	{
-		sd.island = (Island*)malloc(sizeof(sd.island[0]));
-		assert(sd.island != NULL);
+			Game_Init();
+			dirty = false;
+		}
 
-		sd.nislands = 1;
-		sd.nislands_unused = 1;
-	}
-	else
-	{
-		sd.island = NULL;
+		Skirmish_GenGeneral();
+
+		if (!generate_houses)
+		{
+			Tools_RandomLCG_Seed(g_skirmish.seed);
+			Map_CreateLandscape(g_skirmish.seed);
+			ret = true;
+			break;
+		}
 
-		sd.nislands = 0;
-		sd.nislands_unused = 0;
+		/* Most unplayable seeds have no land to build on. */
+		if (!Skirmish_GenerateLandscape(g_skirmish.seed, &sd))
+			continue;
+
+		dirty = true;
+		ret = Skirmish_GenerateMapInner(&sd);
+		if (ret)
+			break;
 	}
 
-	g_generatingMap = true;
-	bool ret = Skirmish_GenerateMapInner(generate_houses, &sd);
 	g_generatingMap = false;
-
-	free(sd.island);
 	g_validateStrictIfZero--;
 
 	assert(g_validateStrictIfZero == 0);
@@ -22,6 +22,7 @@
 #include "../pool/housepool.h"
 #include "../pool/structurepool.h"
 #include "../pool/unitpool.h"
+#include "../replay.h"
 #include "../string.h"
 #include "../table/widgetinfo.h"
 #include "../timer/timer.h"
@@ -244,6 +245,8 @@ void ActionPanel_DrawStructureDescription(Structure* s)
 
 	case STRUCTURE_OUTPOST:
 		{
+			Unit_CountSeenByPlayer();
+
 			Prim_Hline(21, y + 15, 72, 16);
 			GUI_DrawText_Wrapper(String_Get_ByIndex(STR_RADAR_SCAN), 18, y + 8, 29, 0, 0x11, h->unitCountAllied, h->unitCountEnemy);
 		}
@@ -407,6 +410,9 @@ static bool ActionPanel_ScrollFactory(const Widget* widget, Structure* s)
 
 void ActionPanel_BeginPlacementMode(Structure* construction_yard)
 {
+	if (!Replay_Record(REPLAY_PLACEMENT_BEGIN, construction_yard->o.index, 0, 0, 0))
+		return;
+
 	Structure* ns = Structure_Get_ByIndex(construction_yard->o.linkedID);
 
 	g_structureActive = ns;
@@ -418,70 +424,61 @@ void ActionPanel_BeginPlacementMode(Structure* construction_yard)
 	GUI_ChangeSelectionType(SELECTIONTYPE_PLACE);
 }
 
-bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
+/**
+ * Stop placing a structure, and give it back to the construction yard.
+ */
+void ActionPanel_CancelPlacement()
 {
-	if (s->o.flags.s.upgrading)
-		return false;
+	if (!Replay_Record(REPLAY_PLACEMENT_CANCEL, 0, 0, 0, 0))
+		return;
 
-	if (widget->state.keySelected)
+	Structure* s = Structure_Get_ByPackedTile(g_structureActivePosition);
+	Structure* s2 = g_structureActive;
+
+	assert(s2 != NULL);
+
+	if (s != NULL)
 	{
-		if (g_productionStringID == STR_PLACE_IT)
-			ActionPanel_BeginPlacementMode(s);
-		return true;
+		s->o.linkedID = s2->o.index;
 	}
-
-	if (g_factoryWindowTotal < 0)
+	else
 	{
-		Structure_InitFactoryItems(s);
-		ActionPanel_CalculateOptimalLayout(widget, false);
-		ActionPanel_ClampFactoryScrollOffset(widget, s);
+		Structure_Free(s2);
 	}
 
-	if (ActionPanel_ScrollFactory(widget, s))
-		return true;
+	g_structureActive = NULL;
+	g_structureActiveType = 0xFFFF;
 
-	int mouseY;
-	Mouse_TransformToDiv(widget->div, NULL, &mouseY);
-
-	if (mouseY >= widget->offsetY + ActionPanel_ProductionListHeight(widget))
-		return false;
-
-	const bool lmb = (widget->state.buttonState & 0x04);
-	const bool rmb = (widget->state.buttonState & 0x40);
-	int item;
+	GUI_ChangeSelectionType(SELECTIONTYPE_STRUCTURE);
 
-	for (item = 0; item < g_factoryWindowTotal; item++)
-	{
-		int x1, y1, x2, y2;
-
-		ActionPanel_ProductionButtonDimensions(widget, s, item, &x1, &y1, &x2, &y2, NULL, NULL);
-		if (Mouse_InRegion_Div(widget->div, x1, y1, x2, y2))
-			break;
-	}
-
-	/* Upgrade required. */
-	if (g_factoryWindowItems[item].available == -1)
-	{
-		if (item < g_factoryWindowTotal)
-			Audio_PlaySound(EFFECT_ERROR_OCCURRED);
+	g_selectionState = 0; /* Invalid. */
+}
 
-		return false;
-	}
+/**
+ * Carry out a click on an item of the factory window.
+ *
+ * @param s The factory.
+ * @param objectType The item clicked on.
+ * @param productionStringID The state of the factory at the time of the click.
+ * @param available True if the item can be built.
+ * @param lmb True for a left click.
+ * @param rmb True for a right click.
+ * @return False if the order could not be carried out.
+ */
+bool ActionPanel_FactoryOrder(Structure* s, uint16 objectType, uint16 productionStringID, bool available, bool lmb, bool rmb)
+{
+	if (!Replay_Record(REPLAY_FACTORY_ORDER, s->o.index, objectType, productionStringID, (lmb ? 0x01 : 0) | (rmb ? 0x02 : 0) | (available ? 0x04 : 0)))
+		return true;
 
-	const uint16 clicked_type = g_factoryWindowItems[item].objectType;
 	bool action_successful = true;
 
-	if ((s->objectType == clicked_type) || (g_productionStringID == STR_BUILD_IT))
+	if ((s->objectType == objectType) || (productionStringID == STR_BUILD_IT))
 	{
-		switch (g_productionStringID)
+		switch (productionStringID)
 		{
 		case STR_PLACE_IT:
 		case STR_ON_HOLD:
-			if (lmb && (g_productionStringID == STR_PLACE_IT))
-			{
-				ActionPanel_BeginPlacementMode(s);
-			}
-			else if (lmb && (g_productionStringID == STR_ON_HOLD))
+			if (lmb && (productionStringID == STR_ON_HOLD))
 			{
 				s->o.flags.s.repairing = false;
 				s->o.flags.s.onHold = false;
@@ -511,9 +508,9 @@ bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
 		case STR_BUILD_IT:
 			if (lmb)
 			{
-				s->objectType = g_factoryWindowItems[item].objectType;
+				s->objectType = objectType;
 
-				if (g_factoryWindowItems[item].available > 0)
+				if (available)
 					action_successful = Structure_BuildObject(s, s->objectType);
 				else
 					action_successful = false;
@@ -524,12 +521,12 @@ bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
 		case STR_PCT_DONE:
 			if (lmb)
 			{
-				if (g_factoryWindowItems[item].available > 0)
-					BuildQueue_Add(&s->queue, clicked_type, 0);
+				if (available)
+					BuildQueue_Add(&s->queue, objectType, 0);
 				else
 					action_successful = false;
 			}
-			else if (rmb && (g_productionStringID == STR_PCT_DONE))
+			else if (rmb && (productionStringID == STR_PCT_DONE))
 				s->o.flags.s.onHold = true;
 			break;
 
@@ -541,15 +538,79 @@ bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
 	{
 		if (lmb)
 		{
-			if (g_factoryWindowItems[item].available > 0)
-				BuildQueue_Add(&s->queue, clicked_type, 0);
+			if (available)
+				BuildQueue_Add(&s->queue, objectType, 0);
 			else
 				action_successful = false;
 		}
 		else if (rmb)
-			BuildQueue_RemoveTail(&s->queue, clicked_type, NULL);
+			BuildQueue_RemoveTail(&s->queue, objectType, NULL);
+	}
+
+	return action_successful;
+}
+
+bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
+{
+	if (s->o.flags.s.upgrading)
+		return false;
+
+	if (widget->state.keySelected)
+	{
+		if (g_productionStringID == STR_PLACE_IT)
+			ActionPanel_BeginPlacementMode(s);
+		return true;
 	}
 
+	if (g_factoryWindowTotal < 0)
+	{
+		Structure_InitFactoryItems(s);
+		ActionPanel_CalculateOptimalLayout(widget, false);
+		ActionPanel_ClampFactoryScrollOffset(widget, s);
+	}
+
+	if (ActionPanel_ScrollFactory(widget, s))
+		return true;
+
+	int mouseY;
+	Mouse_TransformToDiv(widget->div, NULL, &mouseY);
+
+	if (mouseY >= widget->offsetY + ActionPanel_ProductionListHeight(widget))
+		return false;
+
+	const bool lmb = (widget->state.buttonState & 0x04);
+	const bool rmb = (widget->state.buttonState & 0x40);
+	int item;
+
+	for (item = 0; item < g_factoryWindowTotal; item++)
+	{
+		int x1, y1, x2, y2;
+
+		ActionPanel_ProductionButtonDimensions(widget, s, item, &x1, &y1, &x2, &y2, NULL, NULL);
+		if (Mouse_InRegion_Div(widget->div, x1, y1, x2, y2))
+			break;
+	}
+
+	/* Upgrade required. */
+	if (g_factoryWindowItems[item].available == -1)
+	{
+		if (item < g_factoryWindowTotal)
+			Audio_PlaySound(EFFECT_ERROR_OCCURRED);
+
+		return false;
+	}
+
+	const uint16 clicked_type = g_factoryWindowItems[item].objectType;
+
+	/* Placing the structure is an order of its own. */
+	if (lmb && (s->objectType == clicked_type) && (g_productionStringID == STR_PLACE_IT))
+	{
+		ActionPanel_BeginPlacementMode(s);
+		return false;
+	}
+
+	const bool action_successful = ActionPanel_FactoryOrder(s, clicked_type, g_productionStringID, g_factoryWindowItems[item].available > 0, lmb, rmb);
+
 	if (!action_successful)
 		Audio_PlaySound(EFFECT_ERROR_OCCURRED);
 
@@ -558,6 +619,9 @@ bool ActionPanel_ClickFactory(const Widget* widget, Structure* s)
 
 void ActionPanel_ClickStarportOrder(Structure* s)
 {
+	if (!Replay_Record(REPLAY_STARPORT_ORDER, s->o.index, 0, 0, 0))
+		return;
+
 	House* h = g_playerHouse;
 
 	while (!BuildQueue_IsEmpty(&s->queue))
@@ -600,23 +664,30 @@ void ActionPanel_ClickStarportOrder(Structure* s)
 	}
 }
 
-static void ActionPanel_ClickStarportPlus(Structure* s, int entry)
+/**
+ * Add an item to the order of a starport.
+ *
+ * @param s The starport.
+ * @param type The unit to order.
+ * @param credits The price of the unit at the time of the click.
+ */
+void ActionPanel_StarportAdd(Structure* s, uint16 type, uint16 credits)
 {
-	const FactoryWindowItem* item = &g_factoryWindowItems[entry];
-	const uint16 type = item->objectType;
+	if (!Replay_Record(REPLAY_STARPORT_ADD, s->o.index, type, credits, 0))
+		return;
 
 	House* h = g_playerHouse;
 
-	if ((g_starportAvailable[type] > 0) && (item->credits <= h->credits))
+	if ((g_starportAvailable[type] > 0) && (credits <= h->credits))
 	{
-		BuildQueue_Add(&s->queue, item->objectType, item->credits);
+		BuildQueue_Add(&s->queue, type, credits);
 
 		if (g_starportAvailable[type] == 1)
 			g_starportAvailable[type] = -1;
 		else
 			g_starportAvailable[type]--;
 
-		h->credits -= item->credits;
+		h->credits -= credits;
 	}
 	else
 	{
@@ -624,10 +695,16 @@ static void ActionPanel_ClickStarportPlus(Structure* s, int entry)
 	}
 }
 
-static void ActionPanel_ClickStarportMinus(Structure* s, int entry)
+/**
+ * Remove an item from the order of a starport.
+ *
+ * @param s The starport.
+ * @param type The unit to remove.
+ */
+void ActionPanel_StarportRemove(Structure* s, uint16 type)
 {
-	const FactoryWindowItem* item = &g_factoryWindowItems[entry];
-	const uint16 type = item->objectType;
+	if (!Replay_Record(REPLAY_STARPORT_REMOVE, s->o.index, type, 0, 0))
+		return;
 
 	House* h = g_playerHouse;
 	int credits;
@@ -685,11 +762,11 @@ bool ActionPanel_ClickStarport(const Widget* widget, Structure* s)
 
 	if (lmb)
 	{
-		ActionPanel_ClickStarportPlus(s, item);
+		ActionPanel_StarportAdd(s, g_factoryWindowItems[item].objectType, g_factoryWindowItems[item].credits);
 	}
 	else if (rmb)
 	{
-		ActionPanel_ClickStarportMinus(s, item);
+		ActionPanel_StarportRemove(s, g_factoryWindowItems[item].objectType);
 	}
 
 	return false;
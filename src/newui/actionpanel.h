@@ -39,8 +39,12 @@ void ActionPanel_DrawMissileCountdown(uint8 fg, int count);
 void ActionPanel_DrawFactory(const Widget* widget, Structure* s);
 void ActionPanel_DrawPalace(const Widget* w, Structure* s);
 void ActionPanel_BeginPlacementMode(Structure* construction_yard);
+void ActionPanel_CancelPlacement();
+bool ActionPanel_FactoryOrder(Structure* s, uint16 objectType, uint16 productionStringID, bool available, bool lmb, bool rmb);
 bool ActionPanel_ClickFactory(const Widget* widget, Structure* s);
 void ActionPanel_ClickStarportOrder(Structure* s);
+void ActionPanel_StarportAdd(Structure* s, uint16 type, uint16 credits);
+void ActionPanel_StarportRemove(Structure* s, uint16 type);
 bool ActionPanel_ClickStarport(const Widget* widget, Structure* s);
 bool ActionPanel_ClickPalace(const Widget* widget, Structure* s);
 
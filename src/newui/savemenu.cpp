@@ -18,6 +18,7 @@
 #include "../input/input.h"
 #include "../input/mouse.h"
 #include "../load.h"
+#include "../replay.h"
 #include "../save.h"
 #include "../shape.h"
 #include "../string.h"
@@ -335,6 +336,7 @@ int SaveMenu_SaveLoad_Click(bool save)
 				const int entry = ws->scrollPosition + (key - 0x1E);
 				const ScrollbarItem* si = Scrollbar_GetItem(scrollbar, entry);
 				LoadFile(si->text);
+				Replay_StartRecording();
 				SaveMenu_FreeScrollbar();
 				Audio_LoadSampleSet(g_table_houseInfo[g_playerHouseID].sampleSet);
 				return -2;
@@ -23,6 +23,7 @@
 #include "../pool/pool.h"
 #include "../pool/structurepool.h"
 #include "../pool/unitpool.h"
+#include "../replay.h"
 #include "../scenario.h"
 #include "../sprites.h"
 #include "../string.h"
@@ -249,7 +250,35 @@ static void Viewport_SelectRegion()
 	}
 }
 
-static void Viewport_Target(Unit* u, UnitActionType action, bool command_button, uint16 packed)
+/**
+ * Check if an order is given to more than one of the player's units.
+ */
+static bool Viewport_IsGroupOrder()
+{
+	int count = 0;
+
+	int iter;
+	for (Unit* u = Unit_FirstSelected(&iter); u != NULL; u = Unit_NextSelected(&iter))
+	{
+		if (Unit_GetHouseID(u) == g_playerHouseID)
+			count++;
+
+		if (count >= 2)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Order a unit of the player to do an action at a tile.
+ *
+ * @param u The unit to order.
+ * @param action The action to do.
+ * @param packed The tile to do the action at.
+ * @param groupOrder True if the order was given to several units at once.
+ */
+void Viewport_OrderUnit(Unit* u, UnitActionType action, uint16 packed, bool groupOrder)
 {
 	uint16 encoded;
 	Unit* target = NULL;
@@ -257,6 +286,9 @@ static void Viewport_Target(Unit* u, UnitActionType action, bool command_button,
 	if (Unit_GetHouseID(u) != g_playerHouseID)
 		return;
 
+	if (!Replay_Record(REPLAY_UNIT_ORDER, u->o.index, action, packed, groupOrder))
+		return;
+
 	/* Action might not be available to the unit due to multiple selection
 	 * (e.g. no attack for saboteurs).
 	 */
@@ -300,6 +332,9 @@ static void Viewport_Target(Unit* u, UnitActionType action, bool command_button,
 	{
 		Unit_SetDestination(u, encoded);
 
+		/* Units moving together share a flow field to the destination. */
+		u->groupMove = !u->detonateAtTarget && groupOrder;
+
 		if (u->detonateAtTarget)
 			target = Tools_Index_GetUnit(u->targetMove);
 	}
@@ -323,14 +358,27 @@ static void Viewport_Target(Unit* u, UnitActionType action, bool command_button,
 	}
 }
 
-static void Viewport_Place()
+static void Viewport_Target(Unit* u, UnitActionType action, bool command_button, uint16 packed)
+{
+	Viewport_OrderUnit(u, action, packed, Viewport_IsGroupOrder());
+}
+
+/**
+ * Place the structure the player is placing at a tile.
+ *
+ * @param packed The top-left tile of the structure.
+ */
+void Viewport_Place(uint16 packed)
 {
+	if (!Replay_Record(REPLAY_PLACE, 0, 0, packed, 0))
+		return;
+
 	const StructureInfo* si = &g_table_structureInfo[g_structureActiveType];
 
 	Structure* s = g_structureActive;
 	House* h = g_playerHouse;
 
-	if (Structure_Place(s, g_selectionPosition, g_playerHouseID))
+	if (Structure_Place(s, packed, g_playerHouseID))
 	{
 		Audio_PlaySound(SOUND_PLACEMENT);
 
@@ -713,7 +761,7 @@ bool Viewport_Click(Widget* w)
 		/* Clicking LMB places structure. */
 		else if ((g_selectionType == SELECTIONTYPE_PLACE) && !mouse_in_scroll_widget)
 		{
-			Viewport_Place();
+			Viewport_Place(g_selectionPosition);
 			return true;
 		}
 
@@ -18,5 +18,7 @@ void Viewport_DrawSelectionBox();
 void Viewport_DrawPanCursor();
 void Viewport_RenderBrush(int x, int y, int blurx);
 bool Viewport_Click(Widget* w);
+void Viewport_OrderUnit(Unit* u, UnitActionType action, uint16 packed, bool groupOrder);
+void Viewport_Place(uint16 packed);
 
 #endif
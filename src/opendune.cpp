@@ -20,11 +20,14 @@
 #include "ai.h"
 #include "animation.h"
 #include "audio/audio.h"
+#include "balance.h"
 #include "common_a5.h"
 #include "config.h"
 #include "cutscene.h"
+#include "enhancement.h"
 #include "explosion.h"
 #include "file.h"
+#include "flowfield.h"
 #include "gfx.h"
 #include "gui/font.h"
 #include "gui/gui.h"
@@ -42,6 +45,7 @@
 #include "pool/unitpool.h"
 #include "pool/structurepool.h"
 #include "pool/teampool.h"
+#include "replay.h"
 #include "scenario.h"
 #include "shape.h"
 #include "sprites.h"
@@ -77,6 +81,27 @@ static bool s_debugForceWin = false; /*!< When true, you immediately win the lev
 uint16 g_validateStrictIfZero = 0; /*!< 0 = strict validation, basically: no-cheat-mode. */
 bool g_generatingMap = false;  /*!< 0 = strict validation, basically: no-cheat-mode. */
 static const bool g_running = true; /*!< true if game needs to keep running; false to stop the game. */
+static const int64_t GAMELOOP_MAX_TICKS_PER_FRAME = 8; /*!< Most game ticks run in one frame when catching up. */
+static const double GAMELOOP_FAST_FORWARD_BUDGET = 0.75 / 60.0; /*!< Seconds of each frame spent on extra game ticks when fast forwarding. */
+static bool s_fastForward = false; /*!< When true, run as many game ticks as time allows between frames. */
+static const int64_t GAMELOOP_REPLAY_SEEK = 60 * 60; /*!< Game ticks to seek by in a replay. */
+static int64_t s_replaySeek = -1; /*!< Game tick of the replay to go to before the next frame, or -1. */
+static const int GAMELOOP_LOAD_WINDOW = 300; /*!< Game ticks the tick load is measured over. */
+
+/**
+ * Time spent in game ticks, to show how evenly the work is spread over them.
+ */
+struct TickLoad
+{
+	int count; /*!< The number of ticks measured. */
+	double sum; /*!< The total time, in seconds. */
+	double sumSquares; /*!< The total of the squared times. */
+	double peak; /*!< The longest tick. */
+};
+
+static TickLoad s_tickLoad; /*!< The window being measured. */
+static TickLoad s_tickLoadLast; /*!< The last complete window. */
+
 uint16 g_selectionType = 0;
 uint16 g_selectionTypeNew = 0;
 bool g_viewport_forceRedraw = false; /*!< Force a full redraw of the screen. */
@@ -336,6 +361,45 @@ static void Window_WidgetClick_Create()
 	}
 }
 
+/**
+ * Add the time of a game tick to the tick load.
+ * @param seconds The time the tick took.
+ */
+static void GameLoop_RecordTickLoad(double seconds)
+{
+	s_tickLoad.count++;
+	s_tickLoad.sum += seconds;
+	s_tickLoad.sumSquares += seconds * seconds;
+	s_tickLoad.peak = max(s_tickLoad.peak, seconds);
+
+	if (s_tickLoad.count < GAMELOOP_LOAD_WINDOW)
+		return;
+
+	s_tickLoadLast = s_tickLoad;
+	memset(&s_tickLoad, 0, sizeof(s_tickLoad));
+}
+
+/**
+ * Show the mean, deviation and peak of the time per game tick, over the
+ *  last few seconds of game time.
+ */
+static void GameLoop_DisplayTickLoad()
+{
+	const TickLoad* l = &s_tickLoadLast;
+
+	if (l->count == 0)
+	{
+		GUI_DisplayText("Tick load: not measured yet", 5);
+		return;
+	}
+
+	const double mean = l->sum / l->count;
+	const double variance = max(l->sumSquares / l->count - mean * mean, 0.0);
+
+	GUI_DisplayText("Tick load: %.0f us mean, %.0f us dev, %.0f us peak (%s)", 5,
+			mean * 1e6, sqrt(variance) * 1e6, l->peak * 1e6, enhancement_spread_object_ticks ? "spread" : "in step");
+}
+
 /* Process input not caught by widgets, including keypad scrolling,
  * squad selection, and changing zoom levels.  Also handles screen
  * shake logic.
@@ -413,6 +477,33 @@ static void GameLoop_ProcessUnhandledInput(uint16 key)
 		Audio_DisplayMusicName();
 		break;
 
+	case SCANCODE_F8:
+		s_fastForward = !s_fastForward;
+		GUI_DisplayText(s_fastForward ? "Fast forward on" : "Fast forward off", 5);
+		break;
+
+	case SCANCODE_F12:
+		GameLoop_DisplayTickLoad();
+		break;
+
+	case SCANCODE_F9:
+		if (Replay_IsPlaying())
+		{
+			Replay_Stop();
+			GUI_DisplayText("Replay stopped", 5);
+		}
+		else if (Replay_StartPlayback())
+			s_replaySeek = 0;
+		else
+			GUI_DisplayText("No replay recorded", 5);
+		break;
+
+	case SCANCODE_F10:
+	case SCANCODE_F11:
+		if (Replay_IsPlaying())
+			s_replaySeek = max(g_timerGame + ((key == SCANCODE_F11) ? GAMELOOP_REPLAY_SEEK : -GAMELOOP_REPLAY_SEEK), (int64_t)0);
+		break;
+
 	case SCANCODE_F6:
 	case SCANCODE_F7:
 		{
@@ -721,6 +812,50 @@ static void GameLoop_GameIntroAnimationMenu()
 	GFX_SetPalette(g_palette1);
 }
 
+/**
+ * Run the game for one tick of g_timerGame.
+ */
+static void GameLoop_Tick()
+{
+	const double start = Timer_GetSeconds();
+
+	Replay_BeginTick();
+
+	UnitAI_SquadLoop();
+	GameLoop_Team();
+	GameLoop_Unit();
+	GameLoop_Structure();
+	GameLoop_House();
+
+	/* Both draw random numbers and change the map, so they are part of the
+	 * game tick rather than of drawing a frame. */
+	Explosion_Tick();
+	Animation_Tick();
+
+	Replay_EndTick();
+
+	GameLoop_RecordTickLoad(Timer_GetSeconds() - start);
+}
+
+/**
+ * Go to a game tick of the replay being played, by loading the keyframe
+ *  before it and running the game up to the tick without drawing.
+ */
+static void GameLoop_SeekReplay(int64_t tick)
+{
+	if (!Replay_LoadKeyframe(tick))
+		return;
+
+	while (g_timerGame < tick && Replay_IsPlaying())
+	{
+		g_timerGame++;
+		GameLoop_Tick();
+	}
+
+	Timer_AddTicks(TIMER_GAME, g_timerGame - Timer_GameTicks());
+	GUI_DisplayText("Replay: %d of %d ticks", 0, (int)g_timerGame, (int)Replay_GetLength());
+}
+
 /**
  * Main game loop.
  */
@@ -728,8 +863,13 @@ void GameLoop_Main(bool new_game, const char* scenario)
 {
 	static int64_t l_timerNext = 0;
 	static int64_t l_timerUnitStatus = 0;
+	static int64_t l_timerBalance = 0;
+	static int64_t l_timerOverlay = 0;
 	static int16 l_selectionState = -2;
 	int frames_skipped = 0;
+	int64_t fastForwardTicks = 0;
+	int64_t fastForwardReport = 0;
+	bool overlayRedraw = true;
 
 	Mouse_TransformFromDiv(SCREENDIV_MENU, &g_mouseX, &g_mouseY);
 
@@ -762,11 +902,21 @@ void GameLoop_Main(bool new_game, const char* scenario)
 
 	g_gameMode = GM_NORMAL;
 	g_gameOverlay = GAMEOVERLAY_NONE;
+	s_fastForward = false;
+	s_replaySeek = -1;
 	Timer_RegisterSource();
+	Replay_StartRecording();
 
 	while (g_gameMode == GM_NORMAL)
 	{
 		Timer_WaitForEvent();
+
+		if (s_replaySeek >= 0)
+		{
+			GameLoop_SeekReplay(s_replaySeek);
+			s_replaySeek = -1;
+		}
+
 		const int64_t curr_ticks = Timer_GameTicks();
 
 		if (g_gameOverlay == GAMEOVERLAY_NONE)
@@ -785,15 +935,41 @@ void GameLoop_Main(bool new_game, const char* scenario)
 		}
 		else
 		{
+			const GameOverlay overlay = g_gameOverlay;
+
+			/* The game is paused, so only input can change what is shown.
+			 * A held button repeats without new input, and an edit box
+			 * blinks its cursor, so also redraw a few times a second.
+			 */
+			if (Input_HasEvents() || Input_Test((Scancode)MOUSE_LMB) || Timer_GetTicks() >= l_timerOverlay)
+				overlayRedraw = true;
+
 			Input_Tick(true);
 			MenuBar_TickOptionsOverlay();
+
+			if (g_gameOverlay != overlay)
+				overlayRedraw = true;
 		}
 
+		/* Game ticks to run this frame.  After a long stall, only the
+		 * last few are caught up on.
+		 */
+		const int64_t steps = min(curr_ticks - g_timerGame, GAMELOOP_MAX_TICKS_PER_FRAME);
+
 		if (g_gameOverlay == GAMEOVERLAY_NONE && g_timerGame != curr_ticks)
 			g_timerGame = curr_ticks;
 		else if (g_gameOverlay == GAMEOVERLAY_NONE)
 			continue;
 
+		/* Pick up changes to balance.ini while playing. */
+		if (Timer_GetTicks() >= l_timerBalance)
+		{
+			if (Balance_ReloadIfChanged())
+				GUI_DisplayText("Balance tables reloaded", 0);
+
+			l_timerBalance = Timer_GetTicks() + 120;
+		}
+
 		if (g_selectionTypeNew != g_selectionType)
 			GUI_ChangeSelectionType(g_selectionTypeNew);
 
@@ -856,11 +1032,54 @@ void GameLoop_Main(bool new_game, const char* scenario)
 				}
 			}
 
-			UnitAI_SquadLoop();
-			GameLoop_Team();
-			GameLoop_Unit();
-			GameLoop_Structure();
-			GameLoop_House();
+			/* Run every game tick since the last frame, so a slow frame
+			 * does not slow down the game.
+			 */
+			g_timerGame = curr_ticks - steps;
+			for (int64_t i = 0; i < steps; i++)
+			{
+				g_timerGame++;
+				GameLoop_Tick();
+			}
+
+			/* A replay may have skipped ticks. */
+			Timer_AddTicks(TIMER_GAME, g_timerGame - curr_ticks);
+
+			/* Fast forward: keep running game ticks until it is time to draw
+			 * the next frame, and move the game timer along with them.
+			 */
+			if (s_fastForward)
+			{
+				const double deadline = Timer_GetSeconds() + GAMELOOP_FAST_FORWARD_BUDGET;
+				const int64_t start = g_timerGame;
+				int64_t extra = 0;
+
+				while (Timer_GetSeconds() < deadline)
+				{
+					g_timerGame++;
+					extra++;
+
+					GameLoop_Tick();
+				}
+
+				Timer_AddTicks(TIMER_GAME, g_timerGame - start);
+				fastForwardTicks += extra + steps;
+
+				/* Report the measured speed every three seconds. */
+				if (Timer_GetTicks() >= fastForwardReport + 180)
+				{
+					if (fastForwardReport != 0)
+						GUI_DisplayText("Fast forward: %d ticks/s", 0, (int)(fastForwardTicks / 3));
+
+					fastForwardTicks = 0;
+					fastForwardReport = Timer_GetTicks();
+				}
+			}
+			else
+			{
+				fastForwardTicks = 0;
+				fastForwardReport = 0;
+			}
 		}
 
 		if (g_running && !g_debugScenario)
@@ -869,6 +1088,16 @@ void GameLoop_Main(bool new_game, const char* scenario)
 		if (!g_running)
 			break;
 
+		if (g_gameOverlay == GAMEOVERLAY_NONE || g_gameOverlay == GAMEOVERLAY_MENTAT)
+		{
+			Video_InvalidateBackground();
+			overlayRedraw = true;
+		}
+		else if (!overlayRedraw)
+		{
+			continue;
+		}
+
 		if (frames_skipped > 4 || Timer_QueueIsEmpty())
 		{
 			frames_skipped = 0;
@@ -879,8 +1108,16 @@ void GameLoop_Main(bool new_game, const char* scenario)
 				MenuBar_DrawMentatOverlay();
 			else
 			{
-				GUI_DrawInterfaceAndRadar();
+				/* Draw the paused game once, then reuse it. */
+				if (!Video_DrawBackground())
+				{
+					GUI_DrawInterfaceAndRadar();
+					Video_StoreBackground();
+				}
+
 				MenuBar_DrawOptionsOverlay();
+				overlayRedraw = false;
+				l_timerOverlay = Timer_GetTicks() + 5;
 			}
 
 			Video_Tick();
@@ -890,6 +1127,7 @@ void GameLoop_Main(bool new_game, const char* scenario)
 			frames_skipped++;
 	}
 end:
+	Replay_Stop();
 	Timer_UnregisterSource();
 
 	Audio_PlayVoice(VOICE_STOP);
@@ -971,6 +1209,7 @@ int main(int argc, char** argv)
 	if (A5_Init() == false)
 		exit(1);
 
+	Balance_Load();
 	Scenario_InitTables();
 	Input_Init();
 	Audio_LoadSampleSet(SAMPLESET_INVALID);
@@ -1007,6 +1246,11 @@ void Game_Prepare()
 	Structure_Recount();
 	Unit_Recount();
 	Team_Recount();
+	UnitAI_RecountSquads();
+	Map_ResetSpiceIndex();
+	Structure_ResetBuildIndex();
+	FlowField_Init();
+	g_mapRevision++;
 
 	t = &g_map[0];
 	for (i = 0; i < 64 * 64; i++ , t++)
@@ -1105,8 +1349,7 @@ void Game_Prepare()
 		if (h == NULL)
 			break;
 
-		h->structuresBuilt = Structure_GetStructuresBuilt(h);
-		House_UpdateCreditsStorage((uint8)h->index);
+		House_RecountStructures(h);
 		House_CalculatePowerAndCredit(h);
 	}
 
@@ -1145,8 +1388,12 @@ void Game_Init()
 
 	Animation_Init();
 	Explosion_Init();
+	FlowField_Init();
+	g_mapRevision++;
 	memset(g_map, 0, 64 * 64 * sizeof(Tile));
 	Map_ResetFogOfWar();
+	Map_ResetSpiceIndex();
+	Structure_ResetBuildIndex();
 
 	memset(g_mapSpriteID, 0, 64 * 64 * sizeof(uint16));
 	memset(g_starportAvailable, 0, sizeof(g_starportAvailable));
@@ -0,0 +1,182 @@
+/** @file src/parallel_a5.cpp Worker thread routines.
+ *
+ * A batch is cut into parts, one for each worker and one for the main
+ *  thread. The main thread takes part in the batch and returns when every
+ *  part is done, so a batch is just a slower loop to its caller. With a
+ *  single core, or without workers, the job is run on the main thread.
+ */
+
+#include <allegro5/allegro.h>
+#include <cstdio>
+#include "types.h"
+#include "os/math.h"
+
+#include "parallel_a5.h"
+
+enum
+{
+	PARALLEL_WORKERS_MAX = 7
+};
+
+static ALLEGRO_THREAD* s_worker[PARALLEL_WORKERS_MAX];
+static int s_workerCount;
+static ALLEGRO_MUTEX* s_mutex;
+static ALLEGRO_COND* s_condStart; /*!< Signalled when a batch starts, or on quit. */
+static ALLEGRO_COND* s_condDone; /*!< Signalled when the last part of a batch is done. */
+static bool s_quit;
+
+/* The running batch, protected by s_mutex. */
+static ParallelJob s_job;
+static void* s_data;
+static int s_count;
+static int s_parts;
+static int s_nextPart;
+static int s_partsDone;
+static uint32 s_batch; /*!< Increased for each batch, so the workers see a new one. */
+
+static void Parallel_RunPart(int part)
+{
+	const int begin = (int)((int64_t)s_count * part / s_parts);
+	const int end = (int)((int64_t)s_count * (part + 1) / s_parts);
+
+	s_job(begin, end, s_data);
+}
+
+/**
+ * Run parts of the batch until none are left. Call with s_mutex locked.
+ */
+static void Parallel_RunParts()
+{
+	while (s_nextPart < s_parts)
+	{
+		const int part = s_nextPart++;
+
+		al_unlock_mutex(s_mutex);
+		Parallel_RunPart(part);
+		al_lock_mutex(s_mutex);
+
+		if (++s_partsDone == s_parts)
+			al_signal_cond(s_condDone);
+	}
+}
+
+static void* ParallelA5_Worker(ALLEGRO_THREAD* thread, void* arg)
+{
+	uint32 batch = 0;
+
+	UNUSED(thread);
+	UNUSED(arg);
+
+	al_lock_mutex(s_mutex);
+
+	while (true)
+	{
+		while (!s_quit && s_batch == batch)
+			al_wait_cond(s_condStart, s_mutex);
+
+		if (s_quit)
+			break;
+
+		batch = s_batch;
+		Parallel_RunParts();
+	}
+
+	al_unlock_mutex(s_mutex);
+	return NULL;
+}
+
+void ParallelA5_Init()
+{
+	const int workers = min(al_get_cpu_count() - 1, (int)PARALLEL_WORKERS_MAX);
+
+	if (workers <= 0)
+		return;
+
+	s_mutex = al_create_mutex();
+	s_condStart = al_create_cond();
+	s_condDone = al_create_cond();
+
+	if (s_mutex == NULL || s_condStart == NULL || s_condDone == NULL)
+	{
+		fprintf(stderr, "Could not start the worker threads.\n");
+		ParallelA5_Uninit();
+		return;
+	}
+
+	s_quit = false;
+
+	for (s_workerCount = 0; s_workerCount < workers; s_workerCount++)
+	{
+		s_worker[s_workerCount] = al_create_thread(ParallelA5_Worker, NULL);
+		if (s_worker[s_workerCount] == NULL)
+			break;
+
+		al_start_thread(s_worker[s_workerCount]);
+	}
+}
+
+void ParallelA5_Uninit()
+{
+	if (s_mutex != NULL)
+	{
+		al_lock_mutex(s_mutex);
+		s_quit = true;
+		al_broadcast_cond(s_condStart);
+		al_unlock_mutex(s_mutex);
+	}
+
+	/* Joins the threads. */
+	for (int i = 0; i < s_workerCount; i++)
+		al_destroy_thread(s_worker[i]);
+
+	if (s_condDone != NULL)
+		al_destroy_cond(s_condDone);
+
+	if (s_condStart != NULL)
+		al_destroy_cond(s_condStart);
+
+	if (s_mutex != NULL)
+		al_destroy_mutex(s_mutex);
+
+	s_workerCount = 0;
+	s_condDone = NULL;
+	s_condStart = NULL;
+	s_mutex = NULL;
+}
+
+/**
+ * Run a job over count items, spread over the workers.
+ *
+ * @param count The number of items.
+ * @param grain The least number of items worth a part of its own.
+ * @param job The job to run.
+ * @param data Passed to the job.
+ */
+void Parallel_For(int count, int grain, ParallelJob job, void* data)
+{
+	const int parts = min(s_workerCount + 1, count / max(grain, 1));
+
+	if (parts <= 1)
+	{
+		job(0, count, data);
+		return;
+	}
+
+	al_lock_mutex(s_mutex);
+
+	s_job = job;
+	s_data = data;
+	s_count = count;
+	s_parts = parts;
+	s_nextPart = 0;
+	s_partsDone = 0;
+	s_batch++;
+	al_broadcast_cond(s_condStart);
+
+	Parallel_RunParts();
+
+	while (s_partsDone < s_parts)
+		al_wait_cond(s_condDone, s_mutex);
+
+	al_unlock_mutex(s_mutex);
+}
@@ -0,0 +1,16 @@
+/** @file src/parallel_a5.h Worker thread definitions. */
+
+#ifndef PARALLEL_A5_H
+#define PARALLEL_A5_H
+
+/**
+ * Work on the items begin up to (excluding) end. It runs at the same time
+ *  as other parts of the same batch, so it may only read shared state.
+ */
+typedef void (*ParallelJob)(int begin, int end, void* data);
+
+void ParallelA5_Init();
+void ParallelA5_Uninit();
+void Parallel_For(int count, int grain, ParallelJob job, void* data);
+
+#endif /* PARALLEL_A5_H */
@@ -167,6 +167,7 @@ Unit* Unit_Allocate(uint16 index, uint8 type, uint8 houseID)
 	u->permanentFollow = false;
 	u->detonateAtTarget = false;
 	u->deviationDecremented = false;
+	u->groupMove = false;
 	u->squadID = SQUADID_INVALID;
 	u->aiSquad = SQUADID_INVALID;
 	if (type == UNIT_SANDWORM)
@@ -0,0 +1,398 @@
+/** @file src/region.cpp Region graph routines.
+ *
+ * For every movement type the passable tiles are split into connected
+ *  components, so whether a tile can be reached at all is a lookup. Each
+ *  component is further split into clusters: the part of it inside one
+ *  block of REGION_CLUSTER_SIZE by REGION_CLUSTER_SIZE tiles. Clusters that
+ *  touch form a graph, on which long routes are planned.
+ *
+ * Only landscape and structures are considered; units come and go. The
+ *  graph of a movement type is rebuilt when it is used after g_mapRevision
+ *  changed, so it is built at most once per change of the map.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "types.h"
+
+#include "region.h"
+#include "map.h"
+#include "tools/coord.h"
+
+enum
+{
+	REGION_CLUSTER_BITS = 3,
+	REGION_CLUSTER_SIZE = 1 << REGION_CLUSTER_BITS,
+	REGION_CLUSTER_MASK = REGION_CLUSTER_SIZE - 1,
+
+	REGION_NONE = 0,
+	REGION_MAX = MAP_SIZE_MAX * MAP_SIZE_MAX + 1,
+
+	/* Clusters only touch across the edges between blocks; each tile on
+	 *  such an edge touches at most three tiles on the other side. */
+	REGION_EDGE_MAX = 2 * 2 * (MAP_SIZE_MAX / REGION_CLUSTER_SIZE - 1) * MAP_SIZE_MAX * 3
+};
+
+static const int8 s_regionDX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int8 s_regionDY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+static bool s_regionValid[MOVEMENT_MAX];
+static uint32 s_regionRevision[MOVEMENT_MAX]; /*!< The g_mapRevision the graph was built for. */
+static uint16 s_regionClusterCount[MOVEMENT_MAX];
+static uint16 s_regionComponent[MOVEMENT_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Connected component per tile; REGION_NONE if impassable. */
+static uint16 s_regionCluster[MOVEMENT_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< Cluster per tile; REGION_NONE if impassable. */
+static uint16 s_regionClusterTile[MOVEMENT_MAX][REGION_MAX]; /*!< First tile of each cluster. */
+static uint16 s_regionEdgeFirst[MOVEMENT_MAX][REGION_MAX + 1]; /*!< First edge of each cluster in s_regionEdge; the edges of a cluster end where those of the next begin. */
+static uint16 s_regionEdge[MOVEMENT_MAX][REGION_EDGE_MAX]; /*!< The clusters each cluster touches. */
+
+/* Scratch space for flood fills and searches. */
+static uint16 s_regionQueue[REGION_MAX];
+static uint16 s_regionParent[REGION_MAX];
+static uint16 s_regionSeen[REGION_MAX];
+
+static bool Region_IsPassable(uint16 packed, uint8 movementType)
+{
+	if (!Map_IsValidPosition(packed) || g_map[packed].hasStructure)
+		return false;
+
+	return g_table_landscapeInfo[Map_GetLandscapeType(packed)].movementSpeed[movementType] != 0;
+}
+
+/**
+ * Label all tiles connected to a start tile.
+ * @param label The labels per tile; 0 for impassable, 0xFFFF for not labelled yet.
+ * @param start The tile to start from.
+ * @param value The label to give.
+ * @param inCluster If true, do not leave the cluster block of the start tile.
+ */
+static void Region_FloodFill(uint16* label, uint16 start, uint16 value, bool inCluster)
+{
+	const int bx = Tile_GetPackedX(start) >> REGION_CLUSTER_BITS;
+	const int by = Tile_GetPackedY(start) >> REGION_CLUSTER_BITS;
+	int head = 0;
+	int tail = 0;
+
+	label[start] = value;
+	s_regionQueue[tail++] = start;
+
+	while (head < tail)
+	{
+		const uint16 packed = s_regionQueue[head++];
+		const int x = Tile_GetPackedX(packed);
+		const int y = Tile_GetPackedY(packed);
+
+		for (int dir = 0; dir < 8; dir++)
+		{
+			const int nx = x + s_regionDX[dir];
+			const int ny = y + s_regionDY[dir];
+
+			if (nx < 0 || nx >= MAP_SIZE_MAX || ny < 0 || ny >= MAP_SIZE_MAX)
+				continue;
+
+			if (inCluster && ((nx >> REGION_CLUSTER_BITS) != bx || (ny >> REGION_CLUSTER_BITS) != by))
+				continue;
+
+			const uint16 neighbour = Tile_PackXY(nx, ny);
+			if (label[neighbour] != 0xFFFF)
+				continue;
+
+			label[neighbour] = value;
+			s_regionQueue[tail++] = neighbour;
+		}
+	}
+}
+
+/**
+ * Find the clusters each cluster touches.
+ * @param clusters The number of clusters.
+ */
+static void Region_BuildEdges(uint8 movementType, uint16 clusters)
+{
+	const uint16* cluster = s_regionCluster[movementType];
+	uint16* edge = s_regionEdge[movementType];
+	uint16 edges = 0;
+
+	memset(s_regionSeen, 0, sizeof(s_regionSeen));
+
+	for (uint16 c = 1; c <= clusters; c++)
+	{
+		const uint16 first = s_regionClusterTile[movementType][c];
+		const int bx = Tile_GetPackedX(first) & ~REGION_CLUSTER_MASK;
+		const int by = Tile_GetPackedY(first) & ~REGION_CLUSTER_MASK;
+
+		s_regionEdgeFirst[movementType][c] = edges;
+
+		for (int y = by; y < by + REGION_CLUSTER_SIZE; y++)
+		{
+			for (int x = bx; x < bx + REGION_CLUSTER_SIZE; x++)
+			{
+				if (cluster[Tile_PackXY(x, y)] != c)
+					continue;
+
+				for (int dir = 0; dir < 8; dir++)
+				{
+					const int nx = x + s_regionDX[dir];
+					const int ny = y + s_regionDY[dir];
+
+					if (nx < 0 || nx >= MAP_SIZE_MAX || ny < 0 || ny >= MAP_SIZE_MAX)
+						continue;
+
+					const uint16 next = cluster[Tile_PackXY(nx, ny)];
+
+					if (next == REGION_NONE || next == c || s_regionSeen[next] == c)
+						continue;
+
+					assert(edges < REGION_EDGE_MAX);
+					s_regionSeen[next] = c;
+					edge[edges++] = next;
+				}
+			}
+		}
+	}
+
+	s_regionEdgeFirst[movementType][clusters + 1] = edges;
+}
+
+static void Region_Build(uint8 movementType)
+{
+	uint16* component = s_regionComponent[movementType];
+	uint16* cluster = s_regionCluster[movementType];
+	uint16 components = 0;
+	uint16 clusters = 0;
+
+	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++)
+		component[packed] = Region_IsPassable(packed, movementType) ? 0xFFFF : REGION_NONE;
+
+	memcpy(cluster, component, sizeof(s_regionCluster[movementType]));
+
+	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++)
+	{
+		if (component[packed] == 0xFFFF)
+			Region_FloodFill(component, packed, ++components, false);
+	}
+
+	/* Number the clusters block by block, so the tiles of a cluster are found by scanning its block. */
+	for (int by = 0; by < MAP_SIZE_MAX; by += REGION_CLUSTER_SIZE)
+	{
+		for (int bx = 0; bx < MAP_SIZE_MAX; bx += REGION_CLUSTER_SIZE)
+		{
+			for (int y = by; y < by + REGION_CLUSTER_SIZE; y++)
+			{
+				for (int x = bx; x < bx + REGION_CLUSTER_SIZE; x++)
+				{
+					const uint16 packed = Tile_PackXY(x, y);
+
+					if (cluster[packed] != 0xFFFF)
+						continue;
+
+					clusters++;
+					s_regionClusterTile[movementType][clusters] = packed;
+					Region_FloodFill(cluster, packed, clusters, true);
+				}
+			}
+		}
+	}
+
+	Region_BuildEdges(movementType, clusters);
+
+	s_regionClusterCount[movementType] = clusters;
+	s_regionValid[movementType] = true;
+	s_regionRevision[movementType] = g_mapRevision;
+}
+
+static void Region_Validate(uint8 movementType)
+{
+	assert(movementType < MOVEMENT_MAX);
+
+	if (!s_regionValid[movementType] || s_regionRevision[movementType] != g_mapRevision)
+		Region_Build(movementType);
+}
+
+/**
+ * Get the cluster of a tile, or of a neighbouring tile in the same component.
+ */
+static uint16 Region_GetCluster(uint8 movementType, uint16 packed, uint16 component)
+{
+	if (s_regionComponent[movementType][packed] == component)
+		return s_regionCluster[movementType][packed];
+
+	const int x = Tile_GetPackedX(packed);
+	const int y = Tile_GetPackedY(packed);
+
+	for (int dir = 0; dir < 8; dir++)
+	{
+		const int nx = x + s_regionDX[dir];
+		const int ny = y + s_regionDY[dir];
+
+		if (nx < 0 || nx >= MAP_SIZE_MAX || ny < 0 || ny >= MAP_SIZE_MAX)
+			continue;
+
+		const uint16 neighbour = Tile_PackXY(nx, ny);
+
+		if (s_regionComponent[movementType][neighbour] == component)
+			return s_regionCluster[movementType][neighbour];
+	}
+
+	return REGION_NONE;
+}
+
+/**
+ * Check if a unit of a movement type can stand on a tile at all, if no
+ *  units are in its way.
+ *
+ * @param movementType The movement type of the unit.
+ * @param packed The tile to check.
+ * @return False if the tile is impassable or has a structure.
+ */
+bool Region_CanEnter(uint8 movementType, uint16 packed)
+{
+	if (movementType == MOVEMENT_WINGER)
+		return true;
+
+	Region_Validate(movementType);
+
+	return s_regionComponent[movementType][packed] != REGION_NONE;
+}
+
+/**
+ * Check if a unit of a movement type can get from one tile to another, if
+ *  no units are in its way.
+ * An impassable destination counts as reachable if a tile next to it is.
+ *
+ * @param movementType The movement type of the unit.
+ * @param packedSrc Where the unit is.
+ * @param packedDst The destination.
+ * @return False if the destination can never be reached from the source.
+ */
+bool Region_IsReachable(uint8 movementType, uint16 packedSrc, uint16 packedDst)
+{
+	if (movementType == MOVEMENT_WINGER)
+		return true;
+
+	Region_Validate(movementType);
+
+	const uint16 component = s_regionComponent[movementType][packedSrc];
+
+	/* A unit on an impassable tile, we cannot say. */
+	if (component == REGION_NONE)
+		return true;
+
+	return Region_GetCluster(movementType, packedDst, component) != REGION_NONE;
+}
+
+/**
+ * Get the tile of a cluster nearest to its centre.
+ */
+static uint16 Region_GetClusterCentre(uint8 movementType, uint16 c)
+{
+	const uint16* cluster = s_regionCluster[movementType];
+	const uint16 first = s_regionClusterTile[movementType][c];
+	const int bx = Tile_GetPackedX(first) & ~REGION_CLUSTER_MASK;
+	const int by = Tile_GetPackedY(first) & ~REGION_CLUSTER_MASK;
+	int sumX = 0;
+	int sumY = 0;
+	int count = 0;
+
+	for (int y = by; y < by + REGION_CLUSTER_SIZE; y++)
+	{
+		for (int x = bx; x < bx + REGION_CLUSTER_SIZE; x++)
+		{
+			if (cluster[Tile_PackXY(x, y)] != c)
+				continue;
+
+			sumX += x;
+			sumY += y;
+			count++;
+		}
+	}
+
+	uint16 res = first;
+	int bestDistance = 0x7FFF;
+
+	for (int y = by; y < by + REGION_CLUSTER_SIZE; y++)
+	{
+		for (int x = bx; x < bx + REGION_CLUSTER_SIZE; x++)
+		{
+			if (cluster[Tile_PackXY(x, y)] != c)
+				continue;
+
+			const int distance = abs(x * count - sumX) + abs(y * count - sumY);
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				res = Tile_PackXY(x, y);
+			}
+		}
+	}
+
+	return res;
+}
+
+/**
+ * Plan a route over the cluster graph, and get a tile to head for first.
+ *
+ * @param movementType The movement type of the unit.
+ * @param packedSrc Where the unit is.
+ * @param packedDst The destination.
+ * @return A tile on the way to the destination; the destination itself if
+ *  it is close by; or 0 if it cannot be reached.
+ */
+uint16 Region_GetWaypoint(uint8 movementType, uint16 packedSrc, uint16 packedDst)
+{
+	if (movementType == MOVEMENT_WINGER)
+		return packedDst;
+
+	Region_Validate(movementType);
+
+	const uint16* cluster = s_regionCluster[movementType];
+	const uint16 component = s_regionComponent[movementType][packedSrc];
+
+	if (component == REGION_NONE)
+		return packedDst;
+
+	const uint16 clusterSrc = cluster[packedSrc];
+	const uint16 clusterDst = Region_GetCluster(movementType, packedDst, component);
+
+	if (clusterDst == REGION_NONE)
+		return 0;
+
+	if (clusterSrc == clusterDst)
+		return packedDst;
+
+	/* Breadth first search from the destination, so the route is read from the source onwards. */
+	int head = 0;
+	int tail = 0;
+
+	memset(s_regionParent, 0, (s_regionClusterCount[movementType] + 1) * sizeof(s_regionParent[0]));
+	s_regionParent[clusterDst] = clusterDst;
+	s_regionQueue[tail++] = clusterDst;
+
+	while (head < tail && s_regionParent[clusterSrc] == REGION_NONE)
+	{
+		const uint16 c = s_regionQueue[head++];
+
+		for (uint16 e = s_regionEdgeFirst[movementType][c]; e < s_regionEdgeFirst[movementType][c + 1]; e++)
+		{
+			const uint16 next = s_regionEdge[movementType][e];
+
+			if (s_regionParent[next] != REGION_NONE)
+				continue;
+
+			s_regionParent[next] = c;
+			s_regionQueue[tail++] = next;
+		}
+	}
+
+	if (s_regionParent[clusterSrc] == REGION_NONE)
+		return 0;
+
+	/* Head two clusters ahead, which is within reach of the regular pathfinder. */
+	const uint16 next = s_regionParent[s_regionParent[clusterSrc]];
+
+	if (next == clusterDst)
+		return packedDst;
+
+	return Region_GetClusterCentre(movementType, next);
+}
@@ -0,0 +1,12 @@
+/** @file src/region.h Region graph definitions. */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include "types.h"
+
+bool Region_CanEnter(uint8 movementType, uint16 packed);
+bool Region_IsReachable(uint8 movementType, uint16 packedSrc, uint16 packedDst);
+uint16 Region_GetWaypoint(uint8 movementType, uint16 packedSrc, uint16 packedDst);
+
+#endif /* REGION_H */
@@ -0,0 +1,597 @@
+/** @file src/replay.cpp Replay routines.
+ *
+ * A replay keeps the orders of the player, together with the state of the
+ *  random generators at the time of each order. Every few minutes of game
+ *  time a keyframe is written with the savegame code. Playing a replay
+ *  back loads the keyframe before the wanted tick, and runs the game from
+ *  there while giving the recorded orders again. As seeking only needs to
+ *  simulate from the nearest keyframe, any point of a long game can be
+ *  reached quickly.
+ *
+ * Explosions and animations are not kept by a savegame, so they are
+ *  written to a file of their own next to each keyframe.
+ *
+ * The replay is written to the replay directory inside the save directory,
+ *  in native byte order.
+ */
+
+#include <allegro5/allegro.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "types.h"
+
+#include "replay.h"
+
+#include "animation.h"
+#include "explosion.h"
+#include "file.h"
+#include "gui/gui.h"
+#include "load.h"
+#include "multichar.h"
+#include "newui/actionpanel.h"
+#include "newui/viewportnewui.h"
+#include "opendune.h"
+#include "os/error.h"
+#include "pool/structurepool.h"
+#include "pool/unitpool.h"
+#include "save.h"
+#include "structure.h"
+#include "timer/timer.h"
+#include "tools/random_general.h"
+#include "tools/random_lcg.h"
+#include "unit.h"
+
+enum
+{
+	REPLAY_VERSION = 2,
+	REPLAY_KEYFRAME_INTERVAL = 60 * 60, /*!< Game ticks between two keyframes. */
+	REPLAY_TIMER_COUNT = 19
+};
+
+#define REPLAY_FILENAME "replay/replay.dat"
+
+/**
+ * An entry of the replay.
+ */
+typedef struct ReplayCommand
+{
+	int64_t tick; /*!< The game tick the entry was made after. */
+	uint32 seed; /*!< State of the general random generator. */
+	uint32 seedLCG; /*!< State of the LCG random generator. */
+	uint8 type; /*!< The ReplayCommandType. */
+	uint8 flags; /*!< Flags of the order. */
+	uint16 index; /*!< The unit or structure given the order; the keyframe number for keyframes. */
+	uint16 arg1; /*!< First argument of the order. */
+	uint16 arg2; /*!< Second argument of the order. */
+} ReplayCommand;
+
+/**
+ * The game state that is not part of a savegame, for each keyframe.
+ */
+typedef struct ReplayKeyframe
+{
+	int64_t tick; /*!< The game tick the keyframe was written after. */
+	int position; /*!< The entry following the keyframe. */
+	int64_t timers[REPLAY_TIMER_COUNT]; /*!< The script timers. */
+} ReplayKeyframe;
+
+bool g_record_replay = false;
+
+static int64_t* const s_replayTimers[REPLAY_TIMER_COUNT] = {
+	&g_tickHousePowerMaintenance,
+	&g_tickHouseHouse,
+	&g_tickHouseStarport,
+	&g_tickHouseReinforcement,
+	&g_tickHouseMissileCountdown,
+	&g_tickHouseStarportAvailability,
+	&g_tickHouseStarportRecalculatePrices,
+	&g_tickStructureDegrade,
+	&g_tickStructureStructure,
+	&g_tickStructureScript,
+	&g_tickStructurePalace,
+	&g_tickTeamGameLoop,
+	&g_tickUnitMovement,
+	&g_tickUnitRotation,
+	&g_tickUnitBlinking,
+	&g_tickUnitUnknown4,
+	&g_tickUnitScript,
+	&g_tickUnitUnknown5,
+	&g_tickUnitDeviation,
+};
+
+/* Recording. */
+static FILE* s_replayFile = NULL;
+static int s_replayKeyframeNext;
+static int64_t s_replayKeyframeTick;
+static int64_t s_replayLastTick;
+
+/* Playback. */
+static bool s_replayPlaying = false;
+static bool s_replayExecuting = false; /*!< True while an order of the replay is carried out. */
+static bool s_replayDesync;
+static ReplayCommand* s_replayCommand = NULL;
+static int s_replayCommandCount;
+static int s_replayCommandNext;
+static ReplayKeyframe* s_replayKeyframe = NULL;
+static int s_replayKeyframeCount;
+
+static void Replay_MakeKeyframeFilename(char* buf, size_t len, int keyframe)
+{
+	snprintf(buf, len, "replay/key%04d.dat", keyframe);
+}
+
+static void Replay_MakeEffectsFilename(char* buf, size_t len, int keyframe)
+{
+	snprintf(buf, len, "replay/key%04d.fx", keyframe);
+}
+
+/**
+ * Write the running explosions and animations of a keyframe.
+ * @return False if the file could not be written.
+ */
+static bool Replay_WriteEffects(int keyframe)
+{
+	char filename[32];
+
+	Replay_MakeEffectsFilename(filename, sizeof(filename), keyframe);
+	FILE* fp = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, filename, "wb");
+	if (fp == NULL)
+		return false;
+
+	const bool ok = Explosion_Save(fp) && Animation_Save(fp);
+	fclose(fp);
+	return ok;
+}
+
+/**
+ * Replace the running explosions and animations by those of a keyframe.
+ *  Only the explosions and animations of the savegame are left if this fails.
+ * @return False if the file could not be read.
+ */
+static bool Replay_LoadEffects(int keyframe)
+{
+	char filename[32];
+
+	Replay_MakeEffectsFilename(filename, sizeof(filename), keyframe);
+	FILE* fp = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, filename, "rb");
+	if (fp == NULL)
+		return false;
+
+	const bool ok = Explosion_Load(fp) && Animation_Load(fp);
+	fclose(fp);
+	return ok;
+}
+
+static void Replay_WriteAt(int64_t tick, ReplayCommandType type, uint16 index, uint16 arg1, uint16 arg2, uint8 flags)
+{
+	ReplayCommand c;
+
+	memset(&c, 0, sizeof(c));
+	c.tick = tick;
+	c.seed = Tools_Random_GetSeed();
+	c.seedLCG = Tools_RandomLCG_GetState();
+	c.type = type;
+	c.flags = flags;
+	c.index = index;
+	c.arg1 = arg1;
+	c.arg2 = arg2;
+
+	if (fwrite(&c, sizeof(c), 1, s_replayFile) != 1)
+	{
+		Error("Error while writing replay.\n");
+		Replay_Stop();
+	}
+}
+
+static void Replay_Write(ReplayCommandType type, uint16 index, uint16 arg1, uint16 arg2, uint8 flags)
+{
+	Replay_WriteAt(g_timerGame, type, index, arg1, arg2, flags);
+}
+
+static void Replay_WriteKeyframe()
+{
+	char filename[32];
+	int64_t timers[REPLAY_TIMER_COUNT];
+
+	Replay_MakeKeyframeFilename(filename, sizeof(filename), s_replayKeyframeNext);
+	if (!SaveFile(filename, "Replay") || !Replay_WriteEffects(s_replayKeyframeNext))
+	{
+		Replay_Stop();
+		return;
+	}
+
+	for (int i = 0; i < REPLAY_TIMER_COUNT; i++)
+		timers[i] = *s_replayTimers[i];
+
+	Replay_Write(REPLAY_KEYFRAME, s_replayKeyframeNext, 0, 0, 0);
+	if (s_replayFile == NULL)
+		return;
+
+	if (fwrite(timers, sizeof(timers), 1, s_replayFile) != 1)
+	{
+		Error("Error while writing replay.\n");
+		Replay_Stop();
+		return;
+	}
+
+	fflush(s_replayFile);
+
+	s_replayKeyframeNext++;
+	s_replayKeyframeTick = g_timerGame + REPLAY_KEYFRAME_INTERVAL;
+}
+
+/**
+ * Start recording a replay of the game, if enabled. Any replay being
+ *  recorded or played is stopped.
+ */
+void Replay_StartRecording()
+{
+	Replay_Stop();
+
+	if (!g_record_replay)
+		return;
+
+	char dir[1024];
+	File_MakeCompleteFilename(dir, sizeof(dir), SEARCHDIR_SAVE_DIR, "replay", false);
+	if (!al_make_directory(dir))
+		return;
+
+	s_replayFile = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, REPLAY_FILENAME, "wb");
+	if (s_replayFile == NULL)
+		return;
+
+	const uint32 header[2] = { CC_DDRP, REPLAY_VERSION };
+	if (fwrite(header, sizeof(header), 1, s_replayFile) != 1)
+	{
+		Replay_Stop();
+		return;
+	}
+
+	/* The first keyframe is written after the first game tick. */
+	s_replayKeyframeNext = 0;
+	s_replayKeyframeTick = 0;
+	s_replayLastTick = -1;
+}
+
+/**
+ * Stop recording or playing a replay.
+ */
+void Replay_Stop()
+{
+	if (s_replayFile != NULL)
+	{
+		fclose(s_replayFile);
+		s_replayFile = NULL;
+	}
+
+	free(s_replayCommand);
+	s_replayCommand = NULL;
+	free(s_replayKeyframe);
+	s_replayKeyframe = NULL;
+
+	s_replayPlaying = false;
+}
+
+/**
+ * Record an order of the player.
+ *
+ * @param type The type of order.
+ * @param index The unit or structure given the order.
+ * @param arg1 First argument of the order.
+ * @param arg2 Second argument of the order.
+ * @param flags Flags of the order.
+ * @return False if the order should not be carried out, as a replay is playing.
+ */
+bool Replay_Record(ReplayCommandType type, uint16 index, uint16 arg1, uint16 arg2, uint8 flags)
+{
+	if (s_replayPlaying)
+		return s_replayExecuting;
+
+	if (s_replayFile != NULL)
+		Replay_Write(type, index, arg1, arg2, flags);
+
+	return true;
+}
+
+static bool Replay_Read()
+{
+	FILE* fp = File_Open_CaseInsensitive(SEARCHDIR_SAVE_DIR, REPLAY_FILENAME, "rb");
+	if (fp == NULL)
+		return false;
+
+	uint32 header[2];
+	if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != CC_DDRP || header[1] != REPLAY_VERSION)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	int commandSize = 0;
+	int keyframeSize = 0;
+	ReplayCommand c;
+
+	s_replayCommandCount = 0;
+	s_replayKeyframeCount = 0;
+
+	while (fread(&c, sizeof(c), 1, fp) == 1)
+	{
+		if (c.type == REPLAY_KEYFRAME)
+		{
+			if (s_replayKeyframeCount == keyframeSize)
+			{
+				keyframeSize = (keyframeSize == 0) ? 64 : 2 * keyframeSize;
+				ReplayKeyframe* keyframe = (ReplayKeyframe*)realloc(s_replayKeyframe, keyframeSize * sizeof(ReplayKeyframe));
+				if (keyframe == NULL)
+				{
+					fclose(fp);
+					return false;
+				}
+
+				s_replayKeyframe = keyframe;
+			}
+
+			ReplayKeyframe* kf = &s_replayKeyframe[s_replayKeyframeCount];
+
+			/* A keyframe cut short by the end of the recording is not used. */
+			if (c.index != s_replayKeyframeCount || fread(kf->timers, sizeof(kf->timers), 1, fp) != 1)
+				break;
+
+			kf->tick = c.tick;
+			kf->position = s_replayCommandCount + 1;
+			s_replayKeyframeCount++;
+		}
+
+		if (s_replayCommandCount == commandSize)
+		{
+			commandSize = (commandSize == 0) ? 1024 : 2 * commandSize;
+			ReplayCommand* command = (ReplayCommand*)realloc(s_replayCommand, commandSize * sizeof(ReplayCommand));
+			if (command == NULL)
+			{
+				fclose(fp);
+				return false;
+			}
+
+			s_replayCommand = command;
+		}
+
+		s_replayCommand[s_replayCommandCount++] = c;
+	}
+
+	fclose(fp);
+
+	return s_replayKeyframeCount > 0;
+}
+
+/**
+ * Start playing back the last recorded replay. Stops recording.
+ *  Use Replay_LoadKeyframe to go to the start of the replay.
+ *
+ * @return False if there is no replay to play.
+ */
+bool Replay_StartPlayback()
+{
+	Replay_Stop();
+
+	if (!Replay_Read())
+	{
+		Replay_Stop();
+		return false;
+	}
+
+	s_replayPlaying = true;
+	s_replayDesync = false;
+	return true;
+}
+
+bool Replay_IsPlaying()
+{
+	return s_replayPlaying;
+}
+
+/**
+ * Get the last game tick of the replay being played.
+ */
+int64_t Replay_GetLength()
+{
+	if (!s_replayPlaying || s_replayCommandCount == 0)
+		return 0;
+
+	return s_replayCommand[s_replayCommandCount - 1].tick;
+}
+
+/**
+ * Load the game at the last keyframe of the replay at or before a tick.
+ *  The game then has to be run up to the tick.
+ *
+ * @param tick The game tick wanted.
+ * @return False if the keyframe could not be loaded.
+ */
+bool Replay_LoadKeyframe(int64_t tick)
+{
+	if (!s_replayPlaying)
+		return false;
+
+	int k = 0;
+	while (k + 1 < s_replayKeyframeCount && s_replayKeyframe[k + 1].tick <= tick)
+		k++;
+
+	const ReplayKeyframe* kf = &s_replayKeyframe[k];
+	const ReplayCommand* c = &s_replayCommand[kf->position - 1];
+	char filename[32];
+
+	Replay_MakeKeyframeFilename(filename, sizeof(filename), k);
+	if (!File_Exists_Ex(SEARCHDIR_SAVE_DIR, filename))
+		return false;
+
+	/* Timeouts in the savegame are relative to the game tick. */
+	g_timerGame = kf->tick;
+	LoadFile(filename);
+
+	/* Also replaces the animations the savegame restarted. */
+	if (!Replay_LoadEffects(k))
+		GUI_DisplayText("Replay: keyframe %d is incomplete", 0, k);
+
+	Tools_Random_Seed(c->seed);
+	Tools_RandomLCG_SetState(c->seedLCG);
+
+	for (int i = 0; i < REPLAY_TIMER_COUNT; i++)
+		*s_replayTimers[i] = kf->timers[i];
+
+	s_replayCommandNext = kf->position;
+	return true;
+}
+
+static void Replay_CheckSeeds(const ReplayCommand* c)
+{
+	if (c->seed == Tools_Random_GetSeed() && c->seedLCG == Tools_RandomLCG_GetState())
+		return;
+
+	/* Only reported: forcing the recorded seeds back in would hide the
+	 * difference, and a seek would end up elsewhere than playing back. */
+	if (!s_replayDesync)
+		GUI_DisplayText("Replay out of sync at tick %d", 0, (int)c->tick);
+
+	s_replayDesync = true;
+}
+
+static void Replay_Execute(const ReplayCommand* c)
+{
+	Unit* u = NULL;
+	Structure* s = NULL;
+
+	if (c->type == REPLAY_UNIT_ORDER)
+	{
+		if (c->index >= UNIT_INDEX_MAX)
+			return;
+
+		u = Unit_Get_ByIndex(c->index);
+		if (!u->o.flags.s.used)
+			return;
+	}
+	else if (c->type != REPLAY_PLACEMENT_CANCEL && c->type != REPLAY_PLACE)
+	{
+		if (c->index >= STRUCTURE_INDEX_MAX_HARD)
+			return;
+
+		s = Structure_Get_ByIndex(c->index);
+		if (!s->o.flags.s.used)
+			return;
+	}
+
+	switch (c->type)
+	{
+	case REPLAY_UNIT_ORDER:
+		Viewport_OrderUnit(u, (UnitActionType)c->arg1, c->arg2, c->flags != 0);
+		break;
+
+	case REPLAY_FACTORY_ORDER:
+		ActionPanel_FactoryOrder(s, c->arg1, c->arg2, (c->flags & 0x04) != 0, (c->flags & 0x01) != 0, (c->flags & 0x02) != 0);
+		break;
+
+	case REPLAY_PLACEMENT_BEGIN:
+		ActionPanel_BeginPlacementMode(s);
+		break;
+
+	case REPLAY_PLACEMENT_CANCEL:
+		if (g_structureActiveType != 0xFFFF)
+			ActionPanel_CancelPlacement();
+		break;
+
+	case REPLAY_PLACE:
+		if (g_structureActiveType != 0xFFFF)
+			Viewport_Place(c->arg2);
+		break;
+
+	case REPLAY_STARPORT_ADD:
+		ActionPanel_StarportAdd(s, c->arg1, c->arg2);
+		break;
+
+	case REPLAY_STARPORT_REMOVE:
+		ActionPanel_StarportRemove(s, c->arg1);
+		break;
+
+	case REPLAY_STARPORT_ORDER:
+		ActionPanel_ClickStarportOrder(s);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/**
+ * Called before each game tick is run. When playing a replay, the orders
+ *  given before the tick are carried out.
+ */
+void Replay_BeginTick()
+{
+	if (s_replayFile != NULL)
+	{
+		/* Ticks are skipped after a long stall; play them back the same way.
+		 * The entry is made at the first tick skipped, with the number of
+		 * ticks skipped split over the arguments. */
+		if (s_replayLastTick >= 0 && g_timerGame != s_replayLastTick + 1)
+		{
+			const uint32 skipped = (uint32)(g_timerGame - (s_replayLastTick + 1));
+
+			Replay_WriteAt(s_replayLastTick + 1, REPLAY_SKIP_TICKS, 0, skipped & 0xFFFF, skipped >> 16, 0);
+		}
+
+		s_replayLastTick = g_timerGame;
+		return;
+	}
+
+	if (!s_replayPlaying)
+		return;
+
+	while (s_replayCommandNext < s_replayCommandCount)
+	{
+		const ReplayCommand* c = &s_replayCommand[s_replayCommandNext];
+
+		if (c->type == REPLAY_SKIP_TICKS)
+		{
+			if (c->tick > g_timerGame)
+				return;
+
+			if (c->tick == g_timerGame)
+				g_timerGame += c->arg1 | ((uint32)c->arg2 << 16);
+
+			s_replayCommandNext++;
+			continue;
+		}
+
+		if (c->tick >= g_timerGame)
+			return;
+
+		Replay_CheckSeeds(c);
+
+		if (c->type != REPLAY_KEYFRAME)
+		{
+			/* Carry out the order at the time it was given. */
+			const int64_t tick = g_timerGame;
+
+			g_timerGame = c->tick;
+			s_replayExecuting = true;
+			Replay_Execute(c);
+			s_replayExecuting = false;
+			g_timerGame = tick;
+		}
+
+		s_replayCommandNext++;
+	}
+
+	GUI_DisplayText("Replay finished", 0);
+	Replay_Stop();
+}
+
+/**
+ * Called after each game tick is run, to write keyframes.
+ */
+void Replay_EndTick()
+{
+	if (s_replayFile == NULL || g_timerGame < s_replayKeyframeTick)
+		return;
+
+	Replay_WriteKeyframe();
+}
@@ -0,0 +1,39 @@
+/** @file src/replay.h Replay definitions. */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <inttypes.h>
+#include "types.h"
+
+/**
+ * The orders of the player kept in a replay.
+ */
+enum ReplayCommandType
+{
+	REPLAY_UNIT_ORDER = 0,
+	REPLAY_FACTORY_ORDER = 1,
+	REPLAY_PLACEMENT_BEGIN = 2,
+	REPLAY_PLACEMENT_CANCEL = 3,
+	REPLAY_PLACE = 4,
+	REPLAY_STARPORT_ADD = 5,
+	REPLAY_STARPORT_REMOVE = 6,
+	REPLAY_STARPORT_ORDER = 7,
+
+	REPLAY_SKIP_TICKS = 0xFE, /*!< Game ticks were skipped after a long stall. */
+	REPLAY_KEYFRAME = 0xFF
+};
+
+extern bool g_record_replay;
+
+void Replay_StartRecording();
+void Replay_Stop();
+bool Replay_Record(ReplayCommandType type, uint16 index, uint16 arg1, uint16 arg2, uint8 flags);
+bool Replay_StartPlayback();
+extern bool Replay_IsPlaying();
+extern int64_t Replay_GetLength();
+extern bool Replay_LoadKeyframe(int64_t tick);
+void Replay_BeginTick();
+void Replay_EndTick();
+
+#endif /* REPLAY_H */
@@ -121,6 +121,7 @@ bool Unit_Load(FILE* fp, uint32 length)
 		u->permanentFollow = false;
 		u->detonateAtTarget = false;
 		u->deviationDecremented = false;
+		u->groupMove = false;
 		u->squadID = SQUADID_INVALID;
 		u->aiSquad = SQUADID_INVALID;
 	}
@@ -10,6 +10,7 @@
 #include "os/math.h"
 
 #include "scenario.h"
+#include "balance.h"
 #include "file.h"
 #include "house.h"
 #include "ini.h"
@@ -414,6 +415,7 @@ static void Scenario_Load_Structure(const char* key, char* settings)
 			return;
 
 		s->o.hitpoints = hitpoints * g_table_structureInfo[s->o.type].o.hitpoints / 256;
+		House_UpdateStructure(s);
 		s->o.flags.s.degrades = false;
 		s->state = STRUCTURE_STATE_IDLE;
 	}
@@ -697,6 +699,7 @@ void Scenario_InitTables()
 	memcpy_s(g_table_houseInfo, sizeof(g_table_houseInfo), g_table_base_houseInfo, sizeof(g_table_base_houseInfo));
 	memcpy_s(g_table_structureInfo, sizeof(g_table_structureInfo), g_table_base_structureInfo, sizeof(g_table_base_structureInfo));
 	memcpy_s(g_table_unitInfo, sizeof(g_table_unitInfo), g_table_base_unitInfo, sizeof(g_table_base_unitInfo));
+	Balance_Apply();
 
 /*#ifdef DEBUG
 	for (int i = 0; i < STRUCTURE_MAX; i++)
@@ -7,8 +7,6 @@
 #include "../gui/gui.h"
 #include "../house.h"
 #include "../pool/teampool.h"
-#include "../pool/pool.h"
-#include "../pool/unitpool.h"
 #include "../team.h"
 #include "../tile.h"
 #include "../tools/coord.h"
@@ -69,11 +67,7 @@ uint16 Script_Team_GetTarget(ScriptEngine* script)
 uint16 Script_Team_AddClosestUnit(ScriptEngine* script)
 {
 	Team* t;
-	Unit* closest = NULL;
-	Unit* closest2 = NULL;
-	uint16 minDistance = 0;
-	uint16 minDistance2 = 0;
-	PoolFindStruct find;
+	Unit* closest;
 
 	UNUSED(script);
 
@@ -82,48 +76,7 @@ uint16 Script_Team_AddClosestUnit(ScriptEngine* script)
 	if (t->members >= t->maxMembers)
 		return 0;
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
-	{
-		Unit* u;
-		Team* t2;
-		uint16 distance;
-
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (!u->o.flags.s.byScenario)
-			continue;
-		if (u->o.type == UNIT_SABOTEUR)
-			continue;
-		if (g_table_unitInfo[u->o.type].movementType != t->movementType)
-			continue;
-		if (u->team == 0)
-		{
-			distance = Tile_GetDistance(t->position, u->o.position);
-			if (distance >= minDistance && minDistance != 0)
-				continue;
-			minDistance = distance;
-			closest = u;
-			continue;
-		}
-
-		t2 = Team_Get_ByIndex(u->team - 1);
-		if (t2->members > t2->minMembers)
-			continue;
-
-		distance = Tile_GetDistance(t->position, u->o.position);
-		if (distance >= minDistance2 && minDistance2 != 0)
-			continue;
-		minDistance2 = distance;
-		closest2 = u;
-	}
-
-	if (closest == NULL)
-		closest = closest2;
+	closest = Team_FindClosestRecruit(t);
 	if (closest == NULL)
 		return 0;
 
@@ -147,25 +100,15 @@ uint16 Script_Team_GetAverageDistance(ScriptEngine* script)
 	uint16 count = 0;
 	uint16 distance = 0;
 	Team* t;
-	PoolFindStruct find;
+	Unit* u;
+	int iter;
 
 	UNUSED(script);
 
 	t = g_scriptCurrentTeam;
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
+	for (u = Team_FirstMember(t, &iter); u != NULL; u = Team_NextMember(t, &iter))
 	{
-		Unit* u;
-
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (t->index != u->team - 1)
-			continue;
 		count++;
 		averageX += (u->o.position.x >> 8) & 0x3f;
 		averageY += (u->o.position.y >> 8) & 0x3f;
@@ -178,21 +121,8 @@ uint16 Script_Team_GetAverageDistance(ScriptEngine* script)
 
 	t->position = Tile_MakeXY(averageX, averageY);
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
-	{
-		Unit* u;
-
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (t->index != u->team - 1)
-			continue;
+	for (u = Team_FirstMember(t, &iter); u != NULL; u = Team_NextMember(t, &iter))
 		distance += Tile_GetDistanceRoundedUp(u->o.position, t->position);
-	}
 
 	distance /= count;
 
@@ -218,29 +148,19 @@ uint16 Script_Team_Unknown0543(ScriptEngine* script)
 	Team* t;
 	uint16 count = 0;
 	uint16 distance;
-	PoolFindStruct find;
+	Unit* u;
+	int iter;
 
 	t = g_scriptCurrentTeam;
 	distance = STACK_PEEK(1);
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
+	for (u = Team_FirstMember(t, &iter); u != NULL; u = Team_NextMember(t, &iter))
 	{
-		Unit* u;
 		tile32 tile;
 		uint16 distanceUnitDest;
 		uint16 distanceUnitTeam;
 		uint16 distanceTeamDest;
 
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (t->index != u->team - 1)
-			continue;
-
 		tile = Tools_Index_GetTile(u->targetMove);
 		distanceUnitTeam = Tile_GetDistanceRoundedUp(u->o.position, t->position);
 
@@ -283,26 +203,17 @@ uint16 Script_Team_Unknown0543(ScriptEngine* script)
 uint16 Script_Team_FindBestTarget(ScriptEngine* script)
 {
 	Team* t;
-	PoolFindStruct find;
+	Unit* u;
+	int iter;
 
 	UNUSED(script);
 
 	t = g_scriptCurrentTeam;
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
+	for (u = Team_FirstMember(t, &iter); u != NULL; u = Team_NextMember(t, &iter))
 	{
-		Unit* u;
 		uint16 target;
 
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (u->team - 1 != t->index)
-			continue;
 		target = Unit_FindBestTargetEncoded(u, t->action == TEAM_ACTION_KAMIKAZE ? 4 : 0);
 		if (target == 0)
 			continue;
@@ -385,7 +296,8 @@ uint16 Script_Team_Unknown0788(ScriptEngine* script)
 {
 	Team* t;
 	tile32 tile;
-	PoolFindStruct find;
+	Unit* u;
+	int iter;
 
 	UNUSED(script);
 
@@ -395,22 +307,12 @@ uint16 Script_Team_Unknown0788(ScriptEngine* script)
 
 	tile = Tools_Index_GetTile(t->target);
 
-	find.houseID = t->houseID;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-
-	while (true)
+	for (u = Team_FirstMember(t, &iter); u != NULL; u = Team_NextMember(t, &iter))
 	{
-		Unit* u;
 		uint16 distance;
 		uint16 packed;
 		int16 orientation;
 
-		u = Unit_Find(&find);
-		if (u == NULL)
-			break;
-		if (u->team - 1 != t->index)
-			continue;
 		if (t->target == 0)
 		{
 			Unit_SetAction(u, ACTION_GUARD);
@@ -12,6 +12,7 @@
 #include "../config.h"
 #include "../enhancement.h"
 #include "../explosion.h"
+#include "../flowfield.h"
 #include "../gui/gui.h"
 #include "../house.h"
 #include "../map.h"
@@ -20,6 +21,7 @@
 #include "../pool/unitpool.h"
 #include "../pool/pool.h"
 #include "../pool/structurepool.h"
+#include "../region.h"
 #include "../scenario.h"
 #include "../structure.h"
 #include "../table/locale.h"
@@ -1471,6 +1473,7 @@ static uint16 Script_Unit_Pathfinder_FindNearbyDestination(Unit* u, uint16 packe
 	else
 		end = lengthof(offset);
 
+	const uint8 movementType = g_table_unitInfo[u->o.type].movementType;
 	const int x0 = Tile_GetPackedX(packedDst);
 	const int y0 = Tile_GetPackedY(packedDst);
 
@@ -1487,6 +1490,9 @@ static uint16 Script_Unit_Pathfinder_FindNearbyDestination(Unit* u, uint16 packe
 		if (Unit_GetTileEnterScore(u, this_dest, 0) == 256)
 			continue;
 
+		if (!Region_IsReachable(movementType, packedSrc, this_dest))
+			continue;
+
 		const int dx = 256 * abs(offset[i].dx);
 		const int dy = 256 * abs(offset[i].dy);
 
@@ -1538,13 +1544,34 @@ uint16 Script_Unit_CalculateRoute(ScriptEngine* script)
 		return 0;
 	}
 
+	/* Units moving as a group follow a shared flow field, unless blocked. */
+	if (u->route[0] == 0xFF && (u->groupMove || UnitAI_IsSquadDestination(u, packedDst)))
+		FlowField_GetRoute(u, packedSrc, packedDst, u->route, lengthof(u->route));
+
 	if (u->route[0] == 0xFF)
 	{
+		const uint8 movementType = g_table_unitInfo[u->o.type].movementType;
+		const bool reachable = Region_IsReachable(movementType, packedSrc, packedDst);
 		Pathfinder_Data res;
 		uint8 buffer[42];
 
+		/* Also for an unreachable destination: its partial route still
+		 * brings the unit closer, for example into firing range.
+		 */
 		res = Script_Unit_Pathfinder(packedSrc, packedDst, buffer, 40);
 
+		/* The pathfinder only looks around obstacles on the direct path.
+		 * If that got us nowhere, plan the route over the region graph
+		 * and head for the next waypoint on it instead.
+		 */
+		if (res.buffer[0] == 0xFF && reachable)
+		{
+			uint16 waypoint = Region_GetWaypoint(movementType, packedSrc, packedDst);
+
+			if (waypoint != 0 && waypoint != packedDst && waypoint != packedSrc)
+				res = Script_Unit_Pathfinder(packedSrc, waypoint, buffer, 40);
+		}
+
 		/* Fallback case: the path finder fails if there are no empty
 		 * spaces on the direct path between packedSrc and packedDst.
 		 * This causes units to sit around, even if there are spots
@@ -1734,6 +1761,7 @@ uint16 Script_Unit_StartAnimation(ScriptEngine* script)
 		animationUnitID += 2;
 
 	g_map[position].houseID = Unit_GetHouseID(u);
+	Structure_InvalidateBuildIndex(position);
 
 	assert(animationUnitID < 4);
 	if (g_table_unitInfo[u->o.type].displayMode == DISPLAYMODE_INFANTRY_3_FRAMES)
@@ -1977,6 +2005,8 @@ uint16 Script_Unit_IsValidDestination(ScriptEngine* script)
 		if (u->o.linkedID == 0xFFFF)
 			return 1;
 		u2 = Unit_Get_ByIndex(u->o.linkedID);
+		if (!Region_CanEnter(g_table_unitInfo[u2->o.type].movementType, index))
+			return 1;
 		u2->o.position = Tools_Index_GetTile(encoded);
 		if (!Unit_IsTileOccupied(u2))
 			return 0;
@@ -48,6 +48,15 @@ static bool s_debugInstantBuild = false; /*!< When non-zero, constructions are a
 
 uint16 g_structureIndex;
 
+/* Build index: per row, a bit for every tile a structure can stand on, and
+ *  per house a bit for every tile that is part of its base. Rows are marked
+ *  dirty by Structure_InvalidateBuildIndex when one of their tiles changes,
+ *  and recomputed when the index is next used.
+ */
+static uint64_t s_buildRowsDirty = ~(uint64_t)0;
+static uint64_t s_buildRowsFree[2][MAP_SIZE_MAX]; /*!< [0] valid for structures, [1] for structures not on concrete; both unoccupied. */
+static uint64_t s_buildRowsBase[HOUSE_MAX][MAP_SIZE_MAX];
+
 static bool Structure_SkipUpgradeLevel(const Structure* s, int level);
 
 /**
@@ -114,6 +123,9 @@ void GameLoop_Structure()
 		g_scriptCurrentUnit = NULL;
 		g_scriptCurrentTeam = NULL;
 
+		if (enhancement_spread_object_ticks)
+			tickScript = Timer_IsObjectTurn(s->o.index, 5);
+
 		if (enhancement_fog_of_war)
 			Structure_RemoveFog(s);
 
@@ -182,6 +194,8 @@ void GameLoop_Structure()
 						s->o.flags.s.repairing = false;
 						s->o.flags.s.onHold = false;
 					}
+
+					House_UpdateStructure(s);
 				}
 				else
 				{
@@ -594,6 +608,7 @@ bool Structure_Place(Structure* s, uint16 position, HouseType houseID)
 					t->overlaySpriteID = 0;
 
 				Map_Update(curPos, 0, false);
+				Structure_InvalidateBuildIndex(curPos);
 
 				result = 1;
 			}
@@ -621,6 +636,7 @@ bool Structure_Place(Structure* s, uint16 position, HouseType houseID)
 					}
 
 					Map_Update(curPos, 0, false);
+					Structure_InvalidateBuildIndex(curPos);
 
 					result = 1;
 				}
@@ -629,6 +645,7 @@ bool Structure_Place(Structure* s, uint16 position, HouseType houseID)
 			if (result == 0)
 				return false;
 
+			g_mapRevision++;
 			Structure_Free(s);
 		}
 		return true;
@@ -700,23 +717,11 @@ bool Structure_Place(Structure* s, uint16 position, HouseType houseID)
 		}
 	}
 
-	if (s->o.type == STRUCTURE_WINDTRAP)
-	{
-		House* h;
-
-		h = House_Get_ByIndex(s->o.houseID);
-		h->windtrapCount += 1;
-	}
-
 	/* ENHANCEMENT -- Calculate structures built before calculating power and credits.
 	 * This prevents MCV starts from draining credits when deployed as
 	 * otherwise the game sees no structures built.
 	 */
-	{
-		House* h;
-		h = House_Get_ByIndex(s->o.houseID);
-		h->structuresBuilt = Structure_GetStructuresBuilt(h);
-	}
+	House_AddStructure(s);
 
 	if (g_validateStrictIfZero == 0)
 	{
@@ -727,6 +732,7 @@ bool Structure_Place(Structure* s, uint16 position, HouseType houseID)
 	}
 
 	Structure_UpdateMap(s);
+	g_mapRevision++;
 
 	return true;
 }
@@ -851,43 +857,135 @@ Structure* Structure_Get_ByPackedTile(uint16 packed)
 }
 
 /**
- * Get a bitmask of all built structure types for the given House.
+ * Mark the whole build index as out of date, after the map was replaced.
+ */
+void Structure_ResetBuildIndex()
+{
+	s_buildRowsDirty = ~(uint64_t)0;
+}
+
+/**
+ * Mark the build index of a tile as out of date, after its landscape, owner
+ *  or occupant changed.
  *
- * @param h The house to get built structures for.
- * @return The bitmask.
+ * @param packed The tile that changed.
  */
-uint32 Structure_GetStructuresBuilt(House* h)
+void Structure_InvalidateBuildIndex(uint16 packed)
 {
-	PoolFindStruct find;
-	uint32 result;
+	s_buildRowsDirty |= (uint64_t)1 << Tile_GetPackedY(packed);
+}
 
-	if (h == NULL)
-		return 0;
+static void Structure_RefreshBuildIndex()
+{
+	for (int y = 0; s_buildRowsDirty != 0 && y < MAP_SIZE_MAX; y++)
+	{
+		if ((s_buildRowsDirty & ((uint64_t)1 << y)) == 0)
+			continue;
 
-	result = 0;
-	find.houseID = h->index;
-	find.index = 0xFFFF;
-	find.type = 0xFFFF;
-	h->windtrapCount = 0;
+		s_buildRowsDirty &= ~((uint64_t)1 << y);
+		s_buildRowsFree[0][y] = 0;
+		s_buildRowsFree[1][y] = 0;
+		for (HouseType h = HOUSE_HARKONNEN; h < HOUSE_MAX; h++)
+			s_buildRowsBase[h][y] = 0;
 
-	while (true)
+		for (int x = 0; x < MAP_SIZE_MAX; x++)
+		{
+			const uint16 packed = Tile_PackXY(x, y);
+			const uint64_t bit = (uint64_t)1 << x;
+			const Tile* t = &g_map[packed];
+
+			if (!Map_IsValidPosition(packed))
+				continue;
+
+			if (t->hasStructure)
+			{
+				const Structure* s = Structure_Get_ByPackedTile(packed);
+
+				if (s != NULL && s->o.houseID < HOUSE_MAX)
+					s_buildRowsBase[s->o.houseID][y] |= bit;
+				continue;
+			}
+
+			const uint16 lst = Map_GetLandscapeType(packed);
+
+			if ((lst == LST_CONCRETE_SLAB || lst == LST_WALL) && t->houseID < HOUSE_MAX)
+				s_buildRowsBase[t->houseID][y] |= bit;
+
+			if (t->hasUnit)
+				continue;
+
+			if (g_table_landscapeInfo[lst].isValidForStructure)
+				s_buildRowsFree[0][y] |= bit;
+			if (g_table_landscapeInfo[lst].isValidForStructure2)
+				s_buildRowsFree[1][y] |= bit;
+		}
+	}
+}
+
+/**
+ * Checks with the build index if a structure fits on the landscape at a
+ *  position. Same as Structure_IsValidBuildLandscape() without any cheats,
+ *  but a few mask tests instead of a probe per tile.
+ *
+ * @param position The (packed) tile to check.
+ * @param type The structure type to check the position for.
+ * @return True if every tile of the structure is valid and unoccupied.
+ */
+bool Structure_IsBuildable(uint16 position, StructureType type)
+{
+	const StructureInfo* si = &g_table_structureInfo[type];
+	const XYSize* size = &g_table_structure_layoutSize[si->layout];
+	const int x = Tile_GetPackedX(position);
+	const int y = Tile_GetPackedY(position);
+
+	if ((position & 0xC000) != 0 || x + size->width > MAP_SIZE_MAX || y + size->height > MAP_SIZE_MAX)
+		return false;
+
+	Structure_RefreshBuildIndex();
+
+	const uint64_t* rows = s_buildRowsFree[si->o.flags.notOnConcrete ? 1 : 0];
+	const uint64_t mask = (((uint64_t)1 << size->width) - 1) << x;
+
+	for (int dy = 0; dy < size->height; dy++)
 	{
-		Structure* s;
+		if ((rows[y + dy] & mask) != mask)
+			return false;
+	}
 
-		s = Structure_Find(&find);
-		if (s == NULL)
-			break;
-		if (s->o.flags.s.isNotOnMap)
-			continue;
-		if (s->o.type == STRUCTURE_SLAB_1x1 || s->o.type == STRUCTURE_SLAB_2x2 || s->o.type == STRUCTURE_WALL)
-			continue;
-		result |= 1 << s->o.type;
+	return true;
+}
+
+/**
+ * Checks with the build index if any tile around a structure at a position
+ *  is part of the base of a house.
+ */
+static bool Structure_IsNextToBase(uint16 position, StructureType type, HouseType houseID)
+{
+	const StructureInfo* si = &g_table_structureInfo[type];
+	const XYSize* size = &g_table_structure_layoutSize[si->layout];
+	const int x = Tile_GetPackedX(position);
+	const int y = Tile_GetPackedY(position);
+	const int xmin = max(x - 1, 0);
+	const int xmax = min(x + size->width, MAP_SIZE_MAX - 1);
+
+	if (houseID >= HOUSE_MAX)
+		return false;
+
+	Structure_RefreshBuildIndex();
+
+	/* From one tile left to one tile right of the structure; minus the structure itself on its own rows. */
+	const uint64_t around = ((uint64_t)2 << xmax) - ((uint64_t)1 << xmin);
+	const uint64_t inside = (((uint64_t)1 << size->width) - 1) << x;
+
+	for (int ty = max(y - 1, 0); ty <= min(y + size->height, MAP_SIZE_MAX - 1); ty++)
+	{
+		const uint64_t mask = (y <= ty && ty < y + size->height) ? (around & ~inside) : around;
 
-		if (s->o.type == STRUCTURE_WINDTRAP)
-			h->windtrapCount++;
+		if ((s_buildRowsBase[houseID][ty] & mask) != 0)
+			return true;
 	}
 
-	return result;
+	return false;
 }
 
 /**
@@ -971,48 +1069,14 @@ int16 Structure_IsValidBuildLandscape(uint16 position, StructureType type)
 
 int16 Structure_IsValidBuildLocation(uint16 position, StructureType type)
 {
-	const StructureInfo* si;
-	uint8 i;
 	int16 retSlabs;
 	bool isValid;
-	uint16 curPos;
 
-	si = &g_table_structureInfo[type];
 	retSlabs = Structure_IsValidBuildLandscape(position, type);
 	isValid = (retSlabs != 0);
 
 	if (g_validateStrictIfZero == 0 && isValid && type != STRUCTURE_CONSTRUCTION_YARD && !g_debugScenario)
-	{
-		isValid = false;
-		for (i = 0; i < 16; i++)
-		{
-			uint16 offset, lst;
-			Structure* s;
-
-			offset = g_table_structure_layoutTilesAround[si->layout][i];
-			if (offset == 0)
-				break;
-
-			curPos = position + offset;
-			s = Structure_Get_ByPackedTile(curPos);
-			if (s != NULL)
-			{
-				if (s->o.houseID != g_playerHouseID)
-					continue;
-				isValid = true;
-				break;
-			}
-
-			lst = Map_GetLandscapeType(curPos);
-			if (lst != LST_CONCRETE_SLAB && lst != LST_WALL)
-				continue;
-			if (g_map[curPos].houseID != g_playerHouseID)
-				continue;
-
-			isValid = true;
-			break;
-		}
-	}
+		isValid = Structure_IsNextToBase(position, type, (HouseType)g_playerHouseID);
 
 	if (!isValid)
 		return 0;
@@ -1292,6 +1356,8 @@ bool Structure_Damage(Structure* s, uint16 damage, uint16 range)
 		s->o.hitpoints = 0;
 	}
 
+	House_UpdateStructure(s);
+
 	if (s->o.hitpoints == 0)
 	{
 		uint16 score;
@@ -1467,6 +1533,10 @@ bool Structure_ConnectWall(uint16 position, bool recurse)
 
 	isDestroyedWall = Map_GetLandscapeType(position) == LST_DESTROYED_WALL;
 
+	/* A wall was built or destroyed. */
+	g_mapRevision++;
+	Structure_InvalidateBuildIndex(position);
+
 	for (i = 0; i < 4; i++)
 	{
 		uint16 curPos = position + offset[i];
@@ -1655,6 +1725,7 @@ void Structure_Remove(Structure* s)
 
 		t = &g_map[curPacked];
 		t->hasStructure = false;
+		Structure_InvalidateBuildIndex(curPacked);
 
 		if (g_debugScenario)
 		{
@@ -1663,6 +1734,8 @@ void Structure_Remove(Structure* s)
 		}
 	}
 
+	g_mapRevision++;
+
 	if (!g_debugScenario)
 	{
 		Animation_Start(g_table_animation_structure[0], s->o.position, si->layout, s->o.houseID, (uint8)si->iconGroup);
@@ -1679,14 +1752,12 @@ void Structure_Remove(Structure* s)
 		break;
 	}
 
+	House_RemoveStructure(s);
 	Structure_Free(s);
 	Structure_UntargetMe(s);
 
-	h->structuresBuilt = Structure_GetStructuresBuilt(h);
 	g_factoryWindowTotal = -1;
 
-	House_UpdateCreditsStorage(s->o.houseID);
-
 	if (g_debugScenario)
 		return;
 
@@ -2068,6 +2139,7 @@ void Structure_UpdateMap(Structure* s)
 		t->houseID = s->o.houseID;
 		t->hasStructure = true;
 		t->index = s->o.index + 1;
+		Structure_InvalidateBuildIndex(position);
 
 		t->groundSpriteID = iconMap[i] + s->rotationSpriteDiff;
 
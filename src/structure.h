@@ -50,6 +50,8 @@ struct Structure
 	uint16 buildCostRemainder; /*!< The remainder of the buildCost for next tick. */
 	int16 state; /*!< The state of the structure. @see StructureState. */
 	uint16 hitpointsMax; /*!< Max amount of hitpoints. */
+	bool isAccounted; /*!< The power and storage totals of the House include this Structure. */
+	uint16 accountedPowerProduction; /*!< The power production included in those totals. */
 
 	SquadID squadID;
 	BuildQueue queue;
@@ -107,7 +109,9 @@ void Structure_SetState(Structure* s, int16 animation);
 bool Structure_SupportsRallyPoints(StructureType s);
 void Structure_SetRallyPoint(Structure* s, uint16 packed);
 Structure* Structure_Get_ByPackedTile(uint16 packed);
-uint32 Structure_GetStructuresBuilt(struct House* h);
+void Structure_ResetBuildIndex();
+void Structure_InvalidateBuildIndex(uint16 packed);
+bool Structure_IsBuildable(uint16 position, StructureType type);
 int16 Structure_IsValidBuildLandscape(uint16 position, StructureType type);
 int16 Structure_IsValidBuildLocation(uint16 position, StructureType type);
 void Structure_ActivateSpecial(Structure* s);
@@ -2,14 +2,164 @@
 
 #include <cstring>
 #include "types.h"
+#include "os/math.h"
 #include "team.h"
 #include "enhancement.h"
 #include "house.h"
 #include "pool/pool.h"
 #include "pool/teampool.h"
 #include "pool/housepool.h"
+#include "pool/unitpool.h"
+#include "map.h"
+#include "opendune.h"
+#include "tile.h"
 #include "timer/timer.h"
+#include "tools/coord.h"
 #include "tools/random_general.h"
+#include "unit.h"
+
+/*
+ * The roster answers the unit queries of team scripts, so they do not each
+ *  look at every unit on the map. It is built at the first query of a pass
+ *  of GameLoop_Team(), and thrown away at the end of it. That works because
+ *  during the pass units do not move, die or change house; they only join
+ *  and leave teams, which the roster follows.
+ *
+ * The entries are in the order of g_unitFindArray, and every list is kept
+ *  in that order, so units are visited in the order Unit_Find() gives them.
+ */
+
+enum
+{
+	TEAM_ROSTER_CELL_SHIFT = 3,
+	TEAM_ROSTER_CELL_SIZE = 1 << TEAM_ROSTER_CELL_SHIFT, /*!< The width of a cell, in tiles. */
+	TEAM_ROSTER_CELLS = MAP_SIZE_MAX >> TEAM_ROSTER_CELL_SHIFT, /*!< The number of cells in a row of the map. */
+	TEAM_ROSTER_END = 0xFFFF
+};
+
+/** The lists an entry can be in. */
+enum TeamRosterList
+{
+	TEAM_ROSTER_FREE = 0, /*!< Recruits without a team, by house, movement type and cell. */
+	TEAM_ROSTER_ASSIGNED = 1, /*!< Recruits in a team, by house and movement type. */
+	TEAM_ROSTER_MEMBER = 2, /*!< Members of a team of their own house, by team. */
+
+	TEAM_ROSTER_LIST_MAX = 3
+};
+
+/** A unit in the roster. */
+struct TeamRosterEntry
+{
+	Unit* unit; /*!< The unit, or NULL if Unit_Find() skips this entry. */
+	uint16 next[TEAM_ROSTER_LIST_MAX]; /*!< The next entry in each list. */
+	bool isListed[TEAM_ROSTER_LIST_MAX]; /*!< The entry is in the list. */
+};
+
+static bool s_rosterValid;
+static TeamRosterEntry s_roster[UNIT_INDEX_MAX];
+static uint16 s_rosterEntry[UNIT_INDEX_MAX]; /*!< The entry of each unit, by unit index. */
+static uint16 s_rosterFree[HOUSE_MAX][MOVEMENT_MAX][TEAM_ROSTER_CELLS * TEAM_ROSTER_CELLS];
+static uint16 s_rosterAssigned[HOUSE_MAX][MOVEMENT_MAX];
+static uint16 s_rosterMembers[TEAM_INDEX_MAX];
+
+/**
+ * Check if a unit can be taken into a team by Script_Team_AddClosestUnit().
+ */
+static bool Team_Roster_IsRecruit(const Unit* u)
+{
+	if (!u->o.flags.s.byScenario)
+		return false;
+	if (u->o.type == UNIT_SABOTEUR)
+		return false;
+
+	return g_table_unitInfo[u->o.type].movementType < MOVEMENT_MAX;
+}
+
+static uint16 Team_Roster_GetCell(tile32 position)
+{
+	return (Tile_GetPosY(position) >> TEAM_ROSTER_CELL_SHIFT) * TEAM_ROSTER_CELLS + (Tile_GetPosX(position) >> TEAM_ROSTER_CELL_SHIFT);
+}
+
+/**
+ * Insert an entry in a list, keeping the list in find order.
+ */
+static void Team_Roster_Insert(uint16* head, uint16 entry, uint8 list)
+{
+	while (*head < entry)
+		head = &s_roster[*head].next[list];
+
+	s_roster[entry].next[list] = *head;
+	s_roster[entry].isListed[list] = true;
+	*head = entry;
+}
+
+static void Team_Roster_Remove(uint16* head, uint16 entry, uint8 list)
+{
+	while (*head != TEAM_ROSTER_END && *head != entry)
+		head = &s_roster[*head].next[list];
+
+	if (*head == entry)
+		*head = s_roster[entry].next[list];
+	s_roster[entry].isListed[list] = false;
+}
+
+/**
+ * Put an entry in the lists that match the current team of its unit.
+ */
+static void Team_Roster_Link(uint16 entry)
+{
+	TeamRosterEntry* e = &s_roster[entry];
+	const Unit* u = e->unit;
+	const uint8 houseID = Unit_GetHouseID(u);
+	uint8 movementType;
+
+	if (u->team != 0 && !e->isListed[TEAM_ROSTER_MEMBER] && Team_Get_ByIndex(u->team - 1)->houseID == houseID)
+		Team_Roster_Insert(&s_rosterMembers[u->team - 1], entry, TEAM_ROSTER_MEMBER);
+
+	if (!Team_Roster_IsRecruit(u))
+		return;
+
+	movementType = g_table_unitInfo[u->o.type].movementType;
+
+	if (u->team == 0 && !e->isListed[TEAM_ROSTER_FREE])
+		Team_Roster_Insert(&s_rosterFree[houseID][movementType][Team_Roster_GetCell(u->o.position)], entry, TEAM_ROSTER_FREE);
+
+	if (u->team != 0 && !e->isListed[TEAM_ROSTER_ASSIGNED])
+		Team_Roster_Insert(&s_rosterAssigned[houseID][movementType], entry, TEAM_ROSTER_ASSIGNED);
+}
+
+/**
+ * Build the roster from the units Unit_Find() gives.
+ */
+static void Team_Roster_Build()
+{
+	memset(s_rosterEntry, 0xFF, sizeof(s_rosterEntry));
+	memset(s_rosterFree, 0xFF, sizeof(s_rosterFree));
+	memset(s_rosterAssigned, 0xFF, sizeof(s_rosterAssigned));
+	memset(s_rosterMembers, 0xFF, sizeof(s_rosterMembers));
+
+	/* Walk backwards, so every entry goes at the head of its lists */
+	for (int i = g_unitFindCount - 1; i >= 0; i--)
+	{
+		TeamRosterEntry* e = &s_roster[i];
+		Unit* u = g_unitFindArray[i];
+
+		memset(e, 0, sizeof(*e));
+
+		if (u == NULL)
+			continue;
+		if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+		if (Unit_GetHouseID(u) >= HOUSE_MAX)
+			continue;
+
+		e->unit = u;
+		s_rosterEntry[u->o.index] = i;
+		Team_Roster_Link(i);
+	}
+
+	s_rosterValid = true;
+}
 
 /**
  * Loop over all teams, performing various of tasks.
@@ -22,6 +172,8 @@ void GameLoop_Team()
 		return;
 	g_tickTeamGameLoop = g_timerGame + (Tools_Random_256() & 7) + 5;
 
+	s_rosterValid = false;
+
 	find.houseID = HOUSE_INVALID;
 	find.index = 0xFFFF;
 	find.type = 0xFFFF;
@@ -57,6 +209,8 @@ void GameLoop_Team()
 
 		Script_Run(&t->script);
 	}
+
+	s_rosterValid = false;
 }
 
 /**
@@ -111,3 +265,201 @@ uint8 Team_ActionStringToType(const char* name)
 
 	return TEAM_ACTION_INVALID;
 }
+
+/**
+ * Find the unit Script_Team_AddClosestUnit() takes into a team: the closest
+ *  recruit without a team, or else the closest recruit of a team that has
+ *  no more than its minimum amount of members.
+ *
+ * Recruits without a team are looked up in the cells around the team, from
+ *  near to far. Like the original sweep over all units, the first unit in
+ *  find order wins a tie.
+ *
+ * @param t The team to find a recruit for.
+ * @return The unit, or NULL if none found.
+ */
+Unit* Team_FindClosestRecruit(const Team* t)
+{
+	const uint16* cells;
+	uint16 best = TEAM_ROSTER_END;
+	uint16 minDistance = 0;
+	Unit* closest2 = NULL;
+	uint16 minDistance2 = 0;
+	int cellX;
+	int cellY;
+
+	if (t->houseID >= HOUSE_MAX || t->movementType >= MOVEMENT_MAX)
+		return NULL;
+
+	if (!s_rosterValid)
+		Team_Roster_Build();
+
+	cells = s_rosterFree[t->houseID][t->movementType];
+	cellX = Tile_GetPosX(t->position) >> TEAM_ROSTER_CELL_SHIFT;
+	cellY = Tile_GetPosY(t->position) >> TEAM_ROSTER_CELL_SHIFT;
+
+	for (int ring = 0; ring < TEAM_ROSTER_CELLS; ring++)
+	{
+		/* Units in this ring of cells are at least this far away */
+		if (ring != 0 && best != TEAM_ROSTER_END && (ring - 1) * TEAM_ROSTER_CELL_SIZE * 256 + 1 > minDistance)
+			break;
+
+		for (int y = max(cellY - ring, 0); y <= min(cellY + ring, TEAM_ROSTER_CELLS - 1); y++)
+		{
+			for (int x = max(cellX - ring, 0); x <= min(cellX + ring, TEAM_ROSTER_CELLS - 1); x++)
+			{
+				if (max(abs(x - cellX), abs(y - cellY)) != ring)
+					continue;
+
+				for (uint16 i = cells[y * TEAM_ROSTER_CELLS + x]; i != TEAM_ROSTER_END; i = s_roster[i].next[TEAM_ROSTER_FREE])
+				{
+					const Unit* u = s_roster[i].unit;
+					uint16 distance;
+
+					if (u->team != 0)
+						continue;
+
+					distance = Tile_GetDistance(t->position, u->o.position);
+					if (best != TEAM_ROSTER_END && (distance > minDistance || (distance == minDistance && i > best)))
+						continue;
+
+					minDistance = distance;
+					best = i;
+				}
+			}
+		}
+	}
+
+	/* The original sweep took a distance of 0 for 'none found yet'; when
+	 *  a unit is right on the team, follow that sweep to get the same unit */
+	if (best != TEAM_ROSTER_END && minDistance == 0)
+	{
+		minDistance = 0;
+
+		for (uint16 i = 0; i < g_unitFindCount; i++)
+		{
+			const Unit* u = s_roster[i].unit;
+			uint16 distance;
+
+			if (!s_roster[i].isListed[TEAM_ROSTER_FREE] || u->team != 0)
+				continue;
+			if (Unit_GetHouseID(u) != t->houseID || g_table_unitInfo[u->o.type].movementType != t->movementType)
+				continue;
+
+			distance = Tile_GetDistance(t->position, u->o.position);
+			if (distance >= minDistance && minDistance != 0)
+				continue;
+			minDistance = distance;
+			best = i;
+		}
+	}
+
+	if (best != TEAM_ROSTER_END)
+		return s_roster[best].unit;
+
+	for (uint16 i = s_rosterAssigned[t->houseID][t->movementType]; i != TEAM_ROSTER_END; i = s_roster[i].next[TEAM_ROSTER_ASSIGNED])
+	{
+		Unit* u = s_roster[i].unit;
+		Team* t2;
+		uint16 distance;
+
+		if (u->team == 0)
+			continue;
+
+		t2 = Team_Get_ByIndex(u->team - 1);
+		if (t2->members > t2->minMembers)
+			continue;
+
+		distance = Tile_GetDistance(t->position, u->o.position);
+		if (distance >= minDistance2 && minDistance2 != 0)
+			continue;
+		minDistance2 = distance;
+		closest2 = u;
+	}
+
+	return closest2;
+}
+
+/**
+ * Get the first member of a team, in find order. Only members of the house
+ *  of the team are given.
+ *
+ * @param t The team.
+ * @param iter Where to keep the position of the iteration.
+ * @return The first member, or NULL if the team has none.
+ */
+Unit* Team_FirstMember(const Team* t, int* iter)
+{
+	if (!s_rosterValid)
+		Team_Roster_Build();
+
+	*iter = (t->index < TEAM_INDEX_MAX) ? s_rosterMembers[t->index] : (uint16)TEAM_ROSTER_END;
+	return Team_NextMember(t, iter);
+}
+
+/**
+ * Get the next member of a team.
+ *
+ * @param t The team.
+ * @param iter The position of the iteration, from Team_FirstMember().
+ * @return The next member, or NULL if there are no more.
+ */
+Unit* Team_NextMember(const Team* t, int* iter)
+{
+	while (*iter != TEAM_ROSTER_END)
+	{
+		const TeamRosterEntry* e = &s_roster[*iter];
+
+		*iter = e->next[TEAM_ROSTER_MEMBER];
+		if (e->unit->team - 1 == t->index)
+			return e->unit;
+	}
+
+	return NULL;
+}
+
+/**
+ * Tell the roster a unit joined a team. Call after the unit is in the team.
+ *
+ * @param u The unit.
+ */
+void Team_Roster_AddMember(Unit* u)
+{
+	uint16 entry;
+
+	if (!s_rosterValid)
+		return;
+
+	entry = s_rosterEntry[u->o.index];
+	if (entry == TEAM_ROSTER_END)
+		return;
+
+	Team_Roster_Link(entry);
+}
+
+/**
+ * Tell the roster a unit leaves its team. Call before the unit is removed.
+ *
+ * @param u The unit.
+ */
+void Team_Roster_RemoveMember(Unit* u)
+{
+	TeamRosterEntry* e;
+	uint16 entry;
+
+	if (!s_rosterValid)
+		return;
+
+	entry = s_rosterEntry[u->o.index];
+	if (entry == TEAM_ROSTER_END)
+		return;
+
+	e = &s_roster[entry];
+
+	if (e->isListed[TEAM_ROSTER_MEMBER])
+		Team_Roster_Remove(&s_rosterMembers[u->team - 1], entry, TEAM_ROSTER_MEMBER);
+
+	/* Without a team it is a free recruit again */
+	if (Team_Roster_IsRecruit(u) && !e->isListed[TEAM_ROSTER_FREE])
+		Team_Roster_Insert(&s_rosterFree[Unit_GetHouseID(u)][g_table_unitInfo[u->o.type].movementType][Team_Roster_GetCell(u->o.position)], entry, TEAM_ROSTER_FREE);
+}
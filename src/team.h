@@ -51,8 +51,16 @@ struct Team
 
 extern const char* const g_table_teamActionName[TEAM_ACTION_MAX];
 
+struct Unit;
+
 void GameLoop_Team();
 Team* Team_Create(uint8 houseID, uint8 teamActionType, uint8 movementType, uint16 unknown1, uint16 unknown2);
 uint8 Team_ActionStringToType(const char* name);
 
+Unit* Team_FindClosestRecruit(const Team* t);
+Unit* Team_FirstMember(const Team* t, int* iter);
+Unit* Team_NextMember(const Team* t, int* iter);
+void Team_Roster_AddMember(Unit* u);
+void Team_Roster_RemoveMember(Unit* u);
+
 #endif /* TEAM_H */
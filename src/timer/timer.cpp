@@ -60,6 +60,20 @@ void Timer_ResetScriptTimers()
 	g_tickUnitDeviation = g_timerGame;
 }
 
+/**
+ * Check if it is the turn of an object for a task that is done every
+ *  period ticks. Objects are spread over the ticks by their index, so
+ *  only a part of them does the task each tick.
+ *
+ * @param index The index of the object.
+ * @param period The number of ticks between two turns of an object.
+ * @return True if and only if the object does the task this tick.
+ */
+bool Timer_IsObjectTurn(uint16 index, uint16 period)
+{
+	return (g_timerGame + index) % period == 0;
+}
+
 uint16
 Tools_AdjustToGameSpeed(uint16 normal, uint16 minimum, uint16 maximum, bool inverseSpeed)
 {
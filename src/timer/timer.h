@@ -40,12 +40,15 @@ extern int64_t g_tickUnitUnknown5;
 extern int64_t g_tickUnitDeviation;
 
 void Timer_ResetScriptTimers();
+bool Timer_IsObjectTurn(uint16 index, uint16 period);
 extern uint16 Tools_AdjustToGameSpeed(uint16 normal, uint16 minimum, uint16 maximum, bool inverseSpeed);
 extern double Timer_GetUnitMovementFrame();
 extern double Timer_GetUnitRotationFrame();
 
 extern bool Timer_SetTimer(TimerType timer, bool set);
 extern int64_t Timer_GetTimer(TimerType timer);
+void Timer_AddTicks(TimerType timer, int64_t ticks);
+double Timer_GetSeconds();
 void Timer_Sleep(int tics);
 void Timer_RegisterSource();
 void Timer_UnregisterSource();
@@ -77,6 +77,23 @@ int64_t Timer_GetTimer(TimerType timer)
 	return al_get_timer_count(s_timer[timer]);
 }
 
+/**
+ * Move a timer forward, for game ticks that were run without waiting for it.
+ */
+void Timer_AddTicks(TimerType timer, int64_t ticks)
+{
+	assert(timer <= TIMER_GAME);
+	al_add_timer_count(s_timer[timer], ticks);
+}
+
+/**
+ * Wall clock time in seconds, for measuring how long work takes.
+ */
+double Timer_GetSeconds()
+{
+	return al_get_time();
+}
+
 void Timer_RegisterSource()
 {
 	ALLEGRO_EVENT_SOURCE* source = al_get_timer_event_source(s_timer[TIMER_GUI]);
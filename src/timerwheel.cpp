@@ -0,0 +1,393 @@
+/* timerwheel.c
+ *
+ * Hierarchical timer wheel.
+ *
+ * Ticks less than TIMERWHEEL_NEAR_SIZE away are kept in the near wheel, one
+ *  slot per tick. Ticks in the next TIMERWHEEL_FAR_SIZE blocks of
+ *  TIMERWHEEL_NEAR_SIZE ticks are kept in the far wheel, and are cascaded
+ *  into the near wheel when their block comes up. Everything further away
+ *  waits in the overflow list.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timerwheel.h"
+
+enum
+{
+	TIMERWHEEL_LIST_NONE = -1, /* Allocated, but not scheduled. */
+	TIMERWHEEL_LIST_FREE = -2  /* On the free list. */
+};
+
+struct TimerWheelNode
+{
+	int64_t when;
+	int next;
+	int prev;
+	int list;
+};
+
+static TimerWheelNode* TimerWheel_GetNode(TimerWheel* wheel, int handle)
+{
+	assert(0 <= handle && handle < wheel->num_chunks * TIMERWHEEL_CHUNK_SIZE);
+
+	char* chunk = wheel->chunk[handle >> TIMERWHEEL_CHUNK_BITS];
+	return (TimerWheelNode *)(chunk + (handle & (TIMERWHEEL_CHUNK_SIZE - 1)) * wheel->stride);
+}
+
+static void TimerWheel_Link(TimerWheel* wheel, int handle, int list)
+{
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+	n->list = list;
+	n->next = TIMERWHEEL_INVALID;
+	n->prev = wheel->tail[list];
+
+	if (wheel->tail[list] != TIMERWHEEL_INVALID)
+		TimerWheel_GetNode(wheel, wheel->tail[list])->next = handle;
+	else
+		wheel->head[list] = handle;
+
+	wheel->tail[list] = handle;
+	wheel->num_scheduled++;
+
+	if (list < TIMERWHEEL_NEAR_SIZE)
+		wheel->num_near++;
+}
+
+static void TimerWheel_Unlink(TimerWheel* wheel, int handle)
+{
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+	const int list = n->list;
+
+	if (list < 0)
+		return;
+
+	if (n->prev != TIMERWHEEL_INVALID)
+		TimerWheel_GetNode(wheel, n->prev)->next = n->next;
+	else
+		wheel->head[list] = n->next;
+
+	if (n->next != TIMERWHEEL_INVALID)
+		TimerWheel_GetNode(wheel, n->next)->prev = n->prev;
+	else
+		wheel->tail[list] = n->prev;
+
+	n->list = TIMERWHEEL_LIST_NONE;
+	wheel->num_scheduled--;
+
+	if (list < TIMERWHEEL_NEAR_SIZE)
+		wheel->num_near--;
+}
+
+/**
+ * Put a record in the list matching its due tick, relative to the current tick.
+ */
+static void TimerWheel_Insert(TimerWheel* wheel, int handle)
+{
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+	if (n->when < wheel->tick)
+		n->when = wheel->tick;
+
+	if (n->when - wheel->tick < TIMERWHEEL_NEAR_SIZE)
+	{
+		TimerWheel_Link(wheel, handle, (int)(n->when & TIMERWHEEL_NEAR_MASK));
+	}
+	else if ((n->when >> TIMERWHEEL_NEAR_BITS) - (wheel->tick >> TIMERWHEEL_NEAR_BITS) < TIMERWHEEL_FAR_SIZE)
+	{
+		TimerWheel_Link(wheel, handle, TIMERWHEEL_NEAR_SIZE + (int)((n->when >> TIMERWHEEL_NEAR_BITS) & TIMERWHEEL_FAR_MASK));
+	}
+	else
+	{
+		TimerWheel_Link(wheel, handle, TIMERWHEEL_LIST_OVERFLOW);
+	}
+}
+
+/**
+ * Re-insert every record of a list; used when the near wheel wraps.
+ */
+static void TimerWheel_Redistribute(TimerWheel* wheel, int list)
+{
+	int handle = wheel->head[list];
+
+	/* Detach the whole list first, as records may land in it again. */
+	wheel->head[list] = TIMERWHEEL_INVALID;
+	wheel->tail[list] = TIMERWHEEL_INVALID;
+
+	while (handle != TIMERWHEEL_INVALID)
+	{
+		TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+		const int next = n->next;
+
+		n->list = TIMERWHEEL_LIST_NONE;
+		wheel->num_scheduled--;
+
+		TimerWheel_Insert(wheel, handle);
+		handle = next;
+	}
+}
+
+static void TimerWheel_Cascade(TimerWheel* wheel)
+{
+	const int far_slot = (int)((wheel->tick >> TIMERWHEEL_NEAR_BITS) & TIMERWHEEL_FAR_MASK);
+
+	if (far_slot == 0)
+		TimerWheel_Redistribute(wheel, TIMERWHEEL_LIST_OVERFLOW);
+
+	TimerWheel_Redistribute(wheel, TIMERWHEEL_NEAR_SIZE + far_slot);
+}
+
+void TimerWheel_Init(TimerWheel* wheel, size_t elem_size, int64_t tick)
+{
+	const size_t stride = (sizeof(TimerWheelNode) + elem_size + 7) & ~(size_t)7;
+
+	if ((wheel->chunk != NULL) && (wheel->elem_size != elem_size))
+		TimerWheel_Free(wheel);
+
+	wheel->elem_size = elem_size;
+	wheel->stride = stride;
+	wheel->tick = tick;
+	wheel->num_scheduled = 0;
+	wheel->num_near = 0;
+
+	for (int i = 0; i < TIMERWHEEL_LIST_MAX; i++)
+	{
+		wheel->head[i] = TIMERWHEEL_INVALID;
+		wheel->tail[i] = TIMERWHEEL_INVALID;
+	}
+
+	/* Keep the chunks from a previous game, but mark all records unused. */
+	wheel->free_list = TIMERWHEEL_INVALID;
+	for (int handle = wheel->num_chunks * TIMERWHEEL_CHUNK_SIZE - 1; handle >= 0; handle--)
+	{
+		TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+		n->list = TIMERWHEEL_LIST_FREE;
+		n->next = wheel->free_list;
+		wheel->free_list = handle;
+	}
+}
+
+void TimerWheel_Free(TimerWheel* wheel)
+{
+	for (int i = 0; i < wheel->num_chunks; i++)
+		free(wheel->chunk[i]);
+
+	free(wheel->chunk);
+	wheel->chunk = NULL;
+	wheel->num_chunks = 0;
+	wheel->free_list = TIMERWHEEL_INVALID;
+	wheel->num_scheduled = 0;
+	wheel->num_near = 0;
+	wheel->elem_size = 0;
+}
+
+/**
+ * Allocate an unscheduled record.
+ * @return The handle of the record, or TIMERWHEEL_INVALID if out of memory.
+ */
+int TimerWheel_Alloc(TimerWheel* wheel)
+{
+	if (wheel->free_list == TIMERWHEEL_INVALID)
+	{
+		char** chunks = (char **)realloc(wheel->chunk, (wheel->num_chunks + 1) * sizeof(char *));
+		if (chunks == NULL)
+			return TIMERWHEEL_INVALID;
+
+		wheel->chunk = chunks;
+
+		char* chunk = (char *)malloc(TIMERWHEEL_CHUNK_SIZE * wheel->stride);
+		if (chunk == NULL)
+			return TIMERWHEEL_INVALID;
+
+		wheel->chunk[wheel->num_chunks] = chunk;
+		wheel->num_chunks++;
+
+		const int first = (wheel->num_chunks - 1) * TIMERWHEEL_CHUNK_SIZE;
+		for (int handle = first + TIMERWHEEL_CHUNK_SIZE - 1; handle >= first; handle--)
+		{
+			TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+			n->list = TIMERWHEEL_LIST_FREE;
+			n->next = wheel->free_list;
+			wheel->free_list = handle;
+		}
+	}
+
+	const int handle = wheel->free_list;
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+	wheel->free_list = n->next;
+	n->list = TIMERWHEEL_LIST_NONE;
+	n->next = TIMERWHEEL_INVALID;
+	n->prev = TIMERWHEEL_INVALID;
+	memset(n + 1, 0, wheel->elem_size);
+	return handle;
+}
+
+/**
+ * Unschedule a record if needed, and return it to the slab.
+ */
+void TimerWheel_Release(TimerWheel* wheel, int handle)
+{
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+	assert(n->list != TIMERWHEEL_LIST_FREE);
+
+	TimerWheel_Unlink(wheel, handle);
+
+	n->list = TIMERWHEEL_LIST_FREE;
+	n->next = wheel->free_list;
+	wheel->free_list = handle;
+}
+
+void* TimerWheel_Get(TimerWheel* wheel, int handle)
+{
+	return TimerWheel_GetNode(wheel, handle) + 1;
+}
+
+/**
+ * (Re)schedule a record. A tick in the past means the current tick.
+ */
+void TimerWheel_Schedule(TimerWheel* wheel, int handle, int64_t when)
+{
+	TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+	assert(n->list != TIMERWHEEL_LIST_FREE);
+
+	TimerWheel_Unlink(wheel, handle);
+	n->when = when;
+	TimerWheel_Insert(wheel, handle);
+}
+
+bool TimerWheel_IsScheduled(TimerWheel* wheel, int handle)
+{
+	return TimerWheel_GetNode(wheel, handle)->list >= 0;
+}
+
+/**
+ * Advance the wheel up to \a now and unschedule the next record due.
+ * @return The handle of the record, or TIMERWHEEL_INVALID if none are due.
+ */
+int TimerWheel_PopDue(TimerWheel* wheel, int64_t now)
+{
+	if (wheel->num_scheduled == 0)
+	{
+		if (wheel->tick < now)
+			wheel->tick = now;
+
+		return TIMERWHEEL_INVALID;
+	}
+
+	while (wheel->tick <= now)
+	{
+		const int handle = wheel->head[wheel->tick & TIMERWHEEL_NEAR_MASK];
+
+		if (handle != TIMERWHEEL_INVALID)
+		{
+			TimerWheel_Unlink(wheel, handle);
+			return handle;
+		}
+
+		if (wheel->tick == now)
+			break;
+
+		/* Nothing in the near wheel: skip to the next block at once. */
+		if (wheel->num_near == 0)
+		{
+			const int64_t next = (wheel->tick | TIMERWHEEL_NEAR_MASK) + 1;
+
+			wheel->tick = (next <= now) ? next : now;
+		}
+		else
+		{
+			wheel->tick++;
+		}
+
+		if ((wheel->tick & TIMERWHEEL_NEAR_MASK) == 0)
+			TimerWheel_Cascade(wheel);
+	}
+
+	return TIMERWHEEL_INVALID;
+}
+
+/**
+ * Write the scheduled records, with the list each is in, in list order.
+ *  Unscheduled records are not written.
+ * @param saveProc Writes the content of a record.
+ * @return True if and only if all bytes were written successful.
+ */
+bool TimerWheel_Save(TimerWheel* wheel, FILE* fp, bool (*saveProc)(FILE* fp, void* elem))
+{
+	const int32_t count = wheel->num_scheduled;
+
+	if (fwrite(&wheel->tick, sizeof(wheel->tick), 1, fp) != 1)
+		return false;
+	if (fwrite(&count, sizeof(count), 1, fp) != 1)
+		return false;
+
+	for (int32_t list = 0; list < TIMERWHEEL_LIST_MAX; list++)
+	{
+		for (int handle = wheel->head[list]; handle != TIMERWHEEL_INVALID;)
+		{
+			TimerWheelNode* n = TimerWheel_GetNode(wheel, handle);
+
+			if (fwrite(&list, sizeof(list), 1, fp) != 1)
+				return false;
+			if (fwrite(&n->when, sizeof(n->when), 1, fp) != 1)
+				return false;
+			if (!saveProc(fp, n + 1))
+				return false;
+
+			handle = n->next;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Replace the content of a wheel with records written by TimerWheel_Save.
+ *  Each record goes back in the list it was in, so records that fall due on
+ *  the same tick come out in the same order as they would have.
+ * @param loadProc Reads the content of a record; gets its new handle.
+ * @return True if and only if all bytes were read successful.
+ */
+bool TimerWheel_Load(TimerWheel* wheel, size_t elem_size, FILE* fp, bool (*loadProc)(FILE* fp, void* elem, int handle))
+{
+	int64_t tick;
+	int32_t count;
+
+	if (fread(&tick, sizeof(tick), 1, fp) != 1)
+		return false;
+	if (fread(&count, sizeof(count), 1, fp) != 1)
+		return false;
+
+	TimerWheel_Init(wheel, elem_size, tick);
+
+	for (int32_t i = 0; i < count; i++)
+	{
+		int32_t list;
+		int64_t when;
+
+		if (fread(&list, sizeof(list), 1, fp) != 1)
+			return false;
+		if (fread(&when, sizeof(when), 1, fp) != 1)
+			return false;
+		if (list < 0 || list >= TIMERWHEEL_LIST_MAX)
+			return false;
+
+		const int handle = TimerWheel_Alloc(wheel);
+		if (handle == TIMERWHEEL_INVALID)
+			return false;
+
+		TimerWheel_GetNode(wheel, handle)->when = when;
+		TimerWheel_Link(wheel, handle, list);
+
+		if (!loadProc(fp, TimerWheel_Get(wheel, handle), handle))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,67 @@
+/** @file src/timerwheel.h Hierarchical timer wheel definitions. */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define TIMERWHEEL_INVALID -1
+
+enum
+{
+	TIMERWHEEL_NEAR_BITS = 8,
+	TIMERWHEEL_NEAR_SIZE = 1 << TIMERWHEEL_NEAR_BITS,
+	TIMERWHEEL_NEAR_MASK = TIMERWHEEL_NEAR_SIZE - 1,
+
+	TIMERWHEEL_FAR_BITS = 6,
+	TIMERWHEEL_FAR_SIZE = 1 << TIMERWHEEL_FAR_BITS,
+	TIMERWHEEL_FAR_MASK = TIMERWHEEL_FAR_SIZE - 1,
+
+	/* Near slots, far slots, then a single overflow list. */
+	TIMERWHEEL_LIST_OVERFLOW = TIMERWHEEL_NEAR_SIZE + TIMERWHEEL_FAR_SIZE,
+	TIMERWHEEL_LIST_MAX = TIMERWHEEL_LIST_OVERFLOW + 1,
+
+	TIMERWHEEL_CHUNK_BITS = 6,
+	TIMERWHEEL_CHUNK_SIZE = 1 << TIMERWHEEL_CHUNK_BITS
+};
+
+/**
+ * A timer wheel keyed by tick.
+ *
+ * Records live in a slab of fixed-size chunks, so a record never moves once
+ *  allocated and can be referred to by its handle. Scheduling and releasing
+ *  a record is O(1).
+ */
+struct TimerWheel
+{
+	size_t elem_size;
+	size_t stride;
+	int64_t tick; /*!< The tick the near wheel is currently at. */
+
+	int num_chunks;
+	char** chunk;
+	int free_list; /*!< Handle of the first unused record. */
+
+	int num_scheduled; /*!< Records in any list. */
+	int num_near; /*!< Records in the near wheel. */
+	int head[TIMERWHEEL_LIST_MAX];
+	int tail[TIMERWHEEL_LIST_MAX];
+};
+
+void TimerWheel_Init(TimerWheel* wheel, size_t elem_size, int64_t tick);
+void TimerWheel_Free(TimerWheel* wheel);
+
+int TimerWheel_Alloc(TimerWheel* wheel);
+void TimerWheel_Release(TimerWheel* wheel, int handle);
+void* TimerWheel_Get(TimerWheel* wheel, int handle);
+
+void TimerWheel_Schedule(TimerWheel* wheel, int handle, int64_t when);
+bool TimerWheel_IsScheduled(TimerWheel* wheel, int handle);
+int TimerWheel_PopDue(TimerWheel* wheel, int64_t now);
+
+bool TimerWheel_Save(TimerWheel* wheel, FILE* fp, bool (*saveProc)(FILE* fp, void* elem));
+bool TimerWheel_Load(TimerWheel* wheel, size_t elem_size, FILE* fp, bool (*loadProc)(FILE* fp, void* elem, int handle));
+
+#endif
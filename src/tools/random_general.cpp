@@ -23,6 +23,14 @@ void Tools_Random_Seed(uint32 seed)
 	s_seed[3] = (seed >> 24) & 0xFF;
 }
 
+/**
+ * @brief   Gets the current state, as can be restored by Tools_Random_Seed.
+ */
+uint32 Tools_Random_GetSeed()
+{
+	return s_seed[0] | (s_seed[1] << 8) | (s_seed[2] << 16) | ((uint32)s_seed[3] << 24);
+}
+
 /**
  * @brief   f__2BB4_0004_0027_DC1D.
  * @details Likely to have been hand-written assembly.
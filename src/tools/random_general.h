@@ -6,6 +6,7 @@
 #include "types.h"
 
 void Tools_Random_Seed(uint32 seed);
+extern uint32 Tools_Random_GetSeed();
 extern uint8 Tools_Random_256();
 
 #endif
@@ -18,6 +18,23 @@ void Tools_RandomLCG_Seed(uint16 seed)
 	s_seed = seed;
 }
 
+/**
+ * @brief   Gets the full state of the generator.
+ * @details Unlike the seed, the state is 32 bits wide.
+ */
+uint32 Tools_RandomLCG_GetState()
+{
+	return s_seed;
+}
+
+/**
+ * @brief   Restores a state from Tools_RandomLCG_GetState.
+ */
+void Tools_RandomLCG_SetState(uint32 state)
+{
+	s_seed = state;
+}
+
 /**
  * @brief   f__01F7_07E5_0011_F68B.
  * @details Exact: int rand().
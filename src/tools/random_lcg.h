@@ -6,6 +6,8 @@
 #include "types.h"
 
 void Tools_RandomLCG_Seed(uint16 seed);
+extern uint32 Tools_RandomLCG_GetState();
+void Tools_RandomLCG_SetState(uint32 state);
 extern uint16 Tools_RandomLCG_Range(uint16 min, uint16 max);
 
 #endif
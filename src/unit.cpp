@@ -23,11 +23,13 @@
 #include "map.h"
 #include "newui/actionpanel.h"
 #include "opendune.h"
+#include "parallel_a5.h"
 #include "pool/pool.h"
 #include "pool/housepool.h"
 #include "pool/structurepool.h"
 #include "pool/unitpool.h"
 #include "pool/teampool.h"
+#include "region.h"
 #include "sprites.h"
 #include "string.h"
 #include "structure.h"
@@ -46,6 +48,9 @@ Unit* g_unitActive = NULL;
 Unit* g_unitHouseMissile = NULL;
 static Unit* g_unitSelected[MAX_SELECTABLE_UNITS];
 
+Unit* g_unitSortArray[UNIT_INDEX_MAX]; /*!< Units in the order they are drawn, see Unit_Sort(). */
+uint16 g_unitSortCount;
+
 /**
  * Number of units of each type available at the starport.
  * \c 0 means not available, \c -1 means \c 0 units, \c >0 means that number of units available.
@@ -351,6 +356,12 @@ void GameLoop_Unit()
 		g_scriptCurrentUnit = u;
 		g_scriptCurrentTeam = NULL;
 
+		if (enhancement_spread_object_ticks)
+		{
+			tickScript = Timer_IsObjectTurn(u->o.index, 5);
+			tickDeviation = Timer_IsObjectTurn(u->o.index, 60);
+		}
+
 		if (u->o.flags.s.isNotOnMap)
 			continue;
 
@@ -745,6 +756,7 @@ void Unit_SetAction(Unit* u, ActionType action)
 	case 1:
 		u->actionID = action;
 		u->nextActionID = ACTION_INVALID;
+		u->groupMove = false;
 		u->currentDestination.x = 0;
 		u->currentDestination.y = 0;
 		u->o.script.delay = 0;
@@ -777,6 +789,8 @@ uint16 Unit_AddToTeam(Unit* u, Team* t)
 	u->team = t->index + 1;
 	t->members++;
 
+	Team_Roster_AddMember(u);
+
 	return t->maxMembers - t->members;
 }
 
@@ -797,6 +811,8 @@ uint16 Unit_RemoveFromTeam(Unit* u)
 
 	t = Team_Get_ByIndex(u->team - 1);
 
+	Team_Roster_RemoveMember(u);
+
 	t->members--;
 	u->team = 0;
 
@@ -819,45 +835,94 @@ Team* Unit_GetTeam(Unit* u)
 }
 
 /**
- * ?? Sorts unit array and count enemy/allied units.
+ * Get the key units are drawn in order of: their y, with infantry
+ *  raised by a tile so they are drawn before what stands just below.
+ *
+ * @param u The unit.
+ * @return The key, ordered as an unsigned value.
+ */
+static uint16 Unit_SortKey(const Unit* u)
+{
+	uint16 y = u->o.position.y;
+
+	if (g_table_unitInfo[u->o.type].movementType == MOVEMENT_FOOT)
+		y -= 0x100;
+
+	return y ^ 0x8000;
+}
+
+/**
+ * Bring #g_unitSortArray up to date: drop freed units, append new ones
+ *  and sort on y. The sort is an insertion sort, which is stable and
+ *  only moves the units whose y changed since the last call.
  */
 void Unit_Sort()
 {
-	House* h;
-	uint16 i;
+	static bool s_inSortArray[UNIT_INDEX_MAX];
+	static uint16 s_key[UNIT_INDEX_MAX];
+	uint16 count = 0;
 
-	h = g_playerHouse;
-	h->unitCountEnemy = 0;
-	h->unitCountAllied = 0;
+	for (uint16 i = 0; i < g_unitSortCount; i++)
+	{
+		Unit* u = g_unitSortArray[i];
 
-	for (i = 0; i < g_unitFindCount - 1; i++)
+		if (!u->o.flags.s.used)
+		{
+			s_inSortArray[u->o.index] = false;
+			continue;
+		}
+
+		g_unitSortArray[count++] = u;
+	}
+
+	for (uint16 i = 0; i < g_unitFindCount; i++)
 	{
-		Unit* u1;
-		Unit* u2;
-		uint16 y1;
-		uint16 y2;
+		Unit* u = g_unitFindArray[i];
 
-		u1 = g_unitFindArray[i];
-		u2 = g_unitFindArray[i + 1];
-		y1 = u1->o.position.y;
-		y2 = u2->o.position.y;
-		if (g_table_unitInfo[u1->o.type].movementType == MOVEMENT_FOOT)
-			y1 -= 0x100;
-		if (g_table_unitInfo[u2->o.type].movementType == MOVEMENT_FOOT)
-			y2 -= 0x100;
+		if (s_inSortArray[u->o.index])
+			continue;
+
+		s_inSortArray[u->o.index] = true;
+		g_unitSortArray[count++] = u;
+	}
+
+	g_unitSortCount = count;
+
+	for (uint16 i = 0; i < count; i++)
+		s_key[i] = Unit_SortKey(g_unitSortArray[i]);
+
+	for (uint16 i = 1; i < count; i++)
+	{
+		Unit* u = g_unitSortArray[i];
+		const uint16 key = s_key[i];
+		uint16 j = i;
 
-		if ((int16)y1 > (int16)y2)
+		for (; j > 0 && s_key[j - 1] > key; j--)
 		{
-			g_unitFindArray[i] = u2;
-			g_unitFindArray[i + 1] = u1;
+			g_unitSortArray[j] = g_unitSortArray[j - 1];
+			s_key[j] = s_key[j - 1];
 		}
+
+		g_unitSortArray[j] = u;
+		s_key[j] = key;
 	}
+}
 
-	for (i = 0; i < g_unitFindCount; i++)
+/**
+ * Count the units of allies and of enemies the player has seen, for
+ *  the radar scan of the outpost.
+ */
+void Unit_CountSeenByPlayer()
+{
+	House* h = g_playerHouse;
+
+	h->unitCountEnemy = 0;
+	h->unitCountAllied = 0;
+
+	for (uint16 i = 0; i < g_unitFindCount; i++)
 	{
-		Unit* u;
+		const Unit* u = g_unitFindArray[i];
 
-		u = g_unitFindArray[i];
 		if ((u->o.seenByHouses & (1 << g_playerHouseID)) != 0 && !u->o.flags.s.isNotOnMap)
 		{
 			if (House_AreAllied(u->o.houseID, g_playerHouseID))
@@ -1087,8 +1152,41 @@ uint16 Unit_GetTargetUnitPriority(Unit* unit, Unit* target)
 	return priority;
 }
 
+/**
+ * Check if a unit can drive up to a structure, going by the tiles around it.
+ *
+ * @param unit The unit to check for.
+ * @param s The structure to drive to.
+ * @return False if no tile around the structure can be reached by the unit.
+ */
+static bool Unit_CanReachStructure(const Unit* unit, const Structure* s)
+{
+	const uint8 movementType = g_table_unitInfo[unit->o.type].movementType;
+	const uint16 packedSrc = Tile_PackTile(unit->o.position);
+	const uint16 packed = Tile_PackTile(s->o.position);
+	const int16* around = g_table_structure_layoutTilesAround[g_table_structureInfo[s->o.type].layout];
+
+	if (unit->o.flags.s.isNotOnMap)
+		return true;
+
+	for (int i = 0; i < 16; i++)
+	{
+		const uint16 curPacked = packed + around[i];
+
+		if (around[i] == 0 || !Map_IsValidPosition(curPacked))
+			continue;
+
+		if (Region_IsReachable(movementType, packedSrc, curPacked))
+			return true;
+	}
+
+	return false;
+}
+
 /**
  * Finds the closest refinery a harvester can go to.
+ *  Refineries it can drive to are preferred; a carryall can bring it to the
+ *  others.
  *
  * @param unit The unit to find the closest refinery for.
  * @return 1 if unit->originEncoded was not 0, else 0.
@@ -1110,25 +1208,8 @@ uint16 Unit_FindClosestRefinery(Unit* unit)
 		return res;
 	}
 
-	find.type = STRUCTURE_REFINERY;
-	find.houseID = Unit_GetHouseID(unit);
-	find.index = 0xFFFF;
-
-	while (true)
-	{
-		s2 = Structure_Find(&find);
-		if (s2 == NULL)
-			break;
-		if (s2->state != STRUCTURE_STATE_BUSY)
-			continue;
-		d = Tile_GetDistance(unit->o.position, s2->o.position);
-		if (mind != 0 && d >= mind)
-			continue;
-		mind = d;
-		s = s2;
-	}
-
-	if (s == NULL)
+	/* Pass 0 and 1 only take reachable refineries; pass 0 and 2 only busy ones. */
+	for (int pass = 0; pass < 4 && s == NULL; pass++)
 	{
 		find.type = STRUCTURE_REFINERY;
 		find.houseID = Unit_GetHouseID(unit);
@@ -1139,9 +1220,13 @@ uint16 Unit_FindClosestRefinery(Unit* unit)
 			s2 = Structure_Find(&find);
 			if (s2 == NULL)
 				break;
+			if ((pass & 1) == 0 && s2->state != STRUCTURE_STATE_BUSY)
+				continue;
 			d = Tile_GetDistance(unit->o.position, s2->o.position);
 			if (mind != 0 && d >= mind)
 				continue;
+			if (pass < 2 && !Unit_CanReachStructure(unit, s2))
+				continue;
 			mind = d;
 			s = s2;
 		}
@@ -1234,6 +1319,48 @@ void Unit_Remove(Unit* u)
 	Unit_Free(u);
 }
 
+/**
+ * A search for the best target unit. The candidates are scored on the
+ *  worker threads; picking the best one is left to the main thread, so
+ *  the result is the same as when scoring them in order.
+ */
+struct TargetUnitSearch
+{
+	Unit* unit; /*!< The Unit looking for a target. */
+	uint16 mode; /*!< How to determine the best target. */
+	tile32 position; /*!< The origin of the Unit. */
+	uint16 distance; /*!< The range to look in, if the mode has one. */
+	uint16 priority[UNIT_INDEX_MAX]; /*!< The priority of each entry in g_unitFindArray. */
+};
+
+static TargetUnitSearch s_targetUnitSearch;
+
+static void Unit_FindBestTargetUnit_Score(int begin, int end, void* data)
+{
+	TargetUnitSearch* search = (TargetUnitSearch *)data;
+	const Unit* u = search->unit;
+
+	for (int i = begin; i < end; i++)
+	{
+		Unit* target = g_unitFindArray[i];
+
+		search->priority[i] = 0;
+
+		/* Skip the same units as Unit_Find(). */
+		if (target == NULL)
+			continue;
+		if (target->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		if (search->mode == 1 && Tile_GetDistance(u->o.position, target->o.position) > search->distance)
+			continue;
+		if (search->mode == 2 && Tile_GetDistance(search->position, target->o.position) > search->distance)
+			continue;
+
+		search->priority[i] = Unit_GetTargetUnitPriority(search->unit, target);
+	}
+}
+
 /**
  * Gets the best target unit for the given unit.
  *
@@ -1243,9 +1370,9 @@ void Unit_Remove(Unit* u)
  */
 Unit* Unit_FindBestTargetUnit(Unit* u, uint16 mode)
 {
+	TargetUnitSearch* search = &s_targetUnitSearch;
 	tile32 position;
 	uint16 distance;
-	PoolFindStruct find;
 	Unit* best = NULL;
 	uint16 bestPriority = 0;
 
@@ -1266,39 +1393,20 @@ Unit* Unit_FindBestTargetUnit(Unit* u, uint16 mode)
 	if (mode == 2)
 		distance <<= 1;
 
-	find.houseID = HOUSE_INVALID;
-	find.type = 0xFFFF;
-	find.index = 0xFFFF;
-
-	while (true)
-	{
-		Unit* target;
-		uint16 priority;
-
-		target = Unit_Find(&find);
+	search->unit = u;
+	search->mode = mode;
+	search->position = position;
+	search->distance = distance;
 
-		if (target == NULL)
-			break;
-
-		if (mode != 0 && mode != 4)
-		{
-			if (mode == 1)
-			{
-				if (Tile_GetDistance(u->o.position, target->o.position) > distance)
-					continue;
-			}
-			if (mode == 2)
-			{
-				if (Tile_GetDistance(position, target->o.position) > distance)
-					continue;
-			}
-		}
+	Parallel_For(g_unitFindCount, 128, Unit_FindBestTargetUnit_Score, search);
 
-		priority = Unit_GetTargetUnitPriority(u, target);
+	for (uint16 i = 0; i < g_unitFindCount; i++)
+	{
+		const uint16 priority = search->priority[i];
 
 		if ((int16)priority > (int16)bestPriority)
 		{
-			best = target;
+			best = g_unitFindArray[i];
 			bestPriority = priority;
 		}
 	}
@@ -2881,15 +2989,15 @@ void Unit_EnterStructure(Unit* unit, Structure* s)
 		else
 			Audio_PlayVoice(VOICE_ENEMY_STRUCTURE_CAPTURED);
 
+		House_RemoveStructure(s);
+
 		h = House_Get_ByIndex(s->o.houseID);
 		s->o.houseID = Unit_GetHouseID(unit);
-		h->structuresBuilt = Structure_GetStructuresBuilt(h);
 
 		/* recalculate the power and credits for the house losing the structure. */
 		House_CalculatePowerAndCredit(h);
 
-		h = House_Get_ByIndex(s->o.houseID);
-		h->structuresBuilt = Structure_GetStructuresBuilt(h);
+		House_AddStructure(s);
 		g_factoryWindowTotal = -1;
 
 		if (s->o.linkedID != 0xFFFF)
@@ -3171,8 +3279,125 @@ void Unit_RemovePlayer(Unit* unit)
 	}
 }
 
+/**
+ * Remember that a Unit is marked on a tile.
+ * @param unit The Unit.
+ * @param packed The packed tile.
+ */
+static void Unit_Occupancy_Add(Unit* unit, uint16 packed)
+{
+	UnitOccupancy* occ = &unit->occupancy;
+
+	for (uint8 i = 0; i < occ->count; i++)
+	{
+		if (occ->tiles[i] == packed)
+			return;
+	}
+
+	/* Out of room; the next removal looks around the Unit instead. */
+	if (occ->count == lengthof(occ->tiles))
+	{
+		occ->isKnown = false;
+		return;
+	}
+
+	occ->tiles[occ->count++] = packed;
+}
+
+/**
+ * Remove a Unit from the tiles it is marked on, except for the tile it is
+ *  moving to.
+ * @param unit The Unit.
+ * @param radius The radius around the Unit to look at if its tiles are not known.
+ */
+static void Unit_Occupancy_Clear(Unit* unit, uint16 radius)
+{
+	UnitOccupancy* occ = &unit->occupancy;
+	const uint16 destination = Tile_PackTile(unit->currentDestination);
+	uint8 count = 0;
+
+	/* Units loaded from a savegame can be marked on tiles we do not know about. */
+	if (!occ->isKnown)
+	{
+		Map_UpdateAround(radius, unit->o.position, unit, 2);
+
+		if (unit->o.type == UNIT_HARVESTER)
+		{
+			Map_UpdateAround(radius, unit->targetPreLast, unit, 2);
+			Map_UpdateAround(radius, unit->targetLast, unit, 2);
+		}
+
+		occ->count = 0;
+		occ->isKnown = true;
+
+		if (Unit_Get_ByPackedTile(destination) == unit)
+			Unit_Occupancy_Add(unit, destination);
+		return;
+	}
+
+	for (uint8 i = 0; i < occ->count; i++)
+	{
+		const uint16 packed = occ->tiles[i];
+		Tile* t = &g_map[packed];
+
+		if (Unit_Get_ByPackedTile(packed) != unit)
+			continue;
+
+		if (packed == destination && !unit->o.flags.s.bulletIsBig)
+		{
+			occ->tiles[count++] = packed;
+			continue;
+		}
+
+		t->index = 0;
+		t->hasUnit = false;
+		Structure_InvalidateBuildIndex(packed);
+	}
+
+	occ->count = count;
+}
+
+/**
+ * Unveil the tiles around a Unit of the player. Without fog of war this
+ *  only has to be done when the Unit covers other tiles than last time.
+ * @param unit The Unit.
+ * @param radius The radius around the Unit to unveil.
+ */
+static void Unit_Occupancy_Unveil(Unit* unit, uint16 radius)
+{
+	UnitOccupancy* occ = &unit->occupancy;
+	const uint16 packed = Tile_PackTile(unit->o.position);
+	uint32 trail = 0;
+
+	if (Unit_GetHouseID(unit) != g_playerHouseID)
+		return;
+
+	if (unit->o.type == UNIT_HARVESTER)
+		trail = ((uint32)Tile_PackTile(unit->targetLast) << 16) | Tile_PackTile(unit->targetPreLast);
+
+	/* With fog of war, unveiling also keeps the tiles in view. */
+	if (!enhancement_fog_of_war && occ->unveiledPacked == packed && occ->unveiledRadius == radius && occ->unveiledTrail == trail)
+		return;
+
+	occ->unveiledPacked = packed;
+	occ->unveiledRadius = radius;
+	occ->unveiledTrail = trail;
+
+	Map_UpdateAround(radius, unit->o.position, unit, 3);
+
+	if (unit->o.type != UNIT_HARVESTER)
+		return;
+
+	/* The harvester is the only 2x1 unit, so also update tiles in behind us. */
+	Map_UpdateAround(radius, unit->targetPreLast, unit, 3);
+	Map_UpdateAround(radius, unit->targetLast, unit, 3);
+}
+
 /**
  * Update the map around the Unit depending on the type (entering tile, leaving, staying).
+ *
+ * The tiles the Unit is marked on are kept in unit->occupancy, so leaving
+ *  only visits those, and staying only updates the unit counts of the houses.
  * @param type The type of action on the map.
  * @param unit The Unit doing the action.
  */
@@ -3189,11 +3414,9 @@ void Unit_UpdateMap(uint16 type, Unit* unit)
 
 	ui = &g_table_unitInfo[unit->o.type];
 
+	/* Air units are never marked on the map. */
 	if (ui->movementType == MOVEMENT_WINGER)
-	{
-		Map_UpdateAround(g_table_unitInfo[unit->o.type].dimension, unit->o.position, unit, g_functions[0][type]);
 		return;
-	}
 
 	position = unit->o.position;
 	packed = Tile_PackTile(position);
@@ -3205,33 +3428,34 @@ void Unit_UpdateMap(uint16 type, Unit* unit)
 	else
 		Unit_HouseUnitCount_Remove(unit);
 
-	if (type == 1)
-	{
-		if (House_AreAllied(Unit_GetHouseID(unit), g_playerHouseID) && !Map_IsPositionUnveiled(packed) && unit->o.type != UNIT_SANDWORM)
-		{
-			Tile_RemoveFogInRadius(position, 1);
-		}
-
-		if (Object_GetByPackedTile(packed) == NULL)
-		{
-			t->index = unit->o.index + 1;
-			t->hasUnit = true;
-		}
-	}
+	if (type == 2)
+		return;
 
 	radius = ui->dimension + 3;
 
 	if (unit->o.flags.s.bulletIsBig || unit->o.flags.s.isSmoking || (unit->o.type == UNIT_HARVESTER && unit->actionID == ACTION_HARVEST))
 		radius = 33;
 
-	Map_UpdateAround(radius, position, unit, g_functions[1][type]);
-
-	if (unit->o.type != UNIT_HARVESTER)
+	if (type == 0)
+	{
+		Unit_Occupancy_Clear(unit, radius);
 		return;
+	}
 
-	/* The harvester is the only 2x1 unit, so also update tiles in behind us. */
-	Map_UpdateAround(radius, unit->targetPreLast, unit, g_functions[1][type]);
-	Map_UpdateAround(radius, unit->targetLast, unit, g_functions[1][type]);
+	if (House_AreAllied(Unit_GetHouseID(unit), g_playerHouseID) && !Map_IsPositionUnveiled(packed) && unit->o.type != UNIT_SANDWORM)
+	{
+		Tile_RemoveFogInRadius(position, 1);
+	}
+
+	if (Object_GetByPackedTile(packed) == NULL)
+	{
+		t->index = unit->o.index + 1;
+		t->hasUnit = true;
+		Unit_Occupancy_Add(unit, packed);
+		Structure_InvalidateBuildIndex(packed);
+	}
+
+	Unit_Occupancy_Unveil(unit, radius);
 }
 
 /**
@@ -3248,6 +3472,7 @@ void Unit_RemoveFromTile(Unit* unit, uint16 packed)
 	{
 		t->index = 0;
 		t->hasUnit = false;
+		Structure_InvalidateBuildIndex(packed);
 	}
 
 	Map_Update(packed, 0, false);
@@ -21,6 +21,19 @@ struct dir24
 	int8 current; /*!< Current direction. */
 };
 
+/**
+ * The tiles a Unit is marked on, see Unit_UpdateMap(). It is not saved.
+ */
+struct UnitOccupancy
+{
+	uint16 tiles[4]; /*!< Packed tiles marked with the Unit. */
+	uint8 count; /*!< The number of tiles in tiles. */
+	bool isKnown; /*!< If false, the Unit may be marked on tiles that are not listed. */
+	uint16 unveiledPacked; /*!< Packed tile the Unit last unveiled around. */
+	uint16 unveiledRadius; /*!< Radius it last unveiled with. */
+	uint32 unveiledTrail; /*!< Packed targetLast and targetPreLast of a harvester when it last unveiled. */
+};
+
 /**
  * A Unit as stored in the memory.
  */
@@ -59,8 +72,10 @@ struct Unit
 	bool permanentFollow;
 	bool detonateAtTarget;
 	bool deviationDecremented;
+	bool groupMove; /*!< Moving as part of a group order; follows a shared flow field. */
 	SquadID squadID;
 	SquadID aiSquad;
+	UnitOccupancy occupancy;
 };
 
 /**
@@ -128,6 +143,8 @@ extern UnitInfo g_table_unitInfo[UNIT_MAX];
 extern Unit* g_unitActive;
 extern Unit* g_unitHouseMissile;
 extern int16 g_starportAvailable[UNIT_MAX];
+extern Unit* g_unitSortArray[];
+extern uint16 g_unitSortCount;
 
 Unit* Unit_FirstSelected(int* iter);
 Unit* Unit_NextSelected(int* iter);
@@ -151,6 +168,7 @@ uint16 Unit_AddToTeam(Unit* u, struct Team* t);
 uint16 Unit_RemoveFromTeam(Unit* u);
 struct Team* Unit_GetTeam(Unit* u);
 void Unit_Sort();
+void Unit_CountSeenByPlayer();
 Unit* Unit_Get_ByPackedTile(uint16 packed);
 uint16 Unit_IsValidMovementIntoStructure(Unit* unit, struct Structure* s);
 void Unit_SetDestination(Unit* u, uint16 destination);
@@ -0,0 +1,169 @@
+/** @file src/video/blit.cpp Blitter routines for 8-bit screens.
+ *
+ * The masked copy and the xor routines work on 16 pixels at a time with
+ *  SSE2 when the compiler targets it, which is always the case for x64.
+ *  The remap and palette routines are table lookups, which SSE2 cannot
+ *  vectorise; they are unrolled instead. Every routine has a plain loop
+ *  for the remaining pixels and for other targets.
+ */
+
+#include "types.h"
+
+#include "blit.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLIT_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Copy pixels, except those of colour 0.
+ *
+ * @param dst The destination.
+ * @param src The source.
+ * @param count The number of pixels.
+ */
+void Blit_CopyMasked(uint8* dst, const uint8* src, int count)
+{
+	int i = 0;
+
+#ifdef BLIT_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		const __m128i skip = _mm_cmpeq_epi8(s, zero);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(skip, d), _mm_andnot_si128(skip, s)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		if (src[i] != 0)
+			dst[i] = src[i];
+	}
+}
+
+/**
+ * Replace every pixel with its entry in a remap table.
+ *
+ * @param buf The pixels.
+ * @param count The number of pixels.
+ * @param remap The 256-entry remap table.
+ */
+void Blit_Remap(uint8* buf, int count, const uint8* remap)
+{
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const uint8 a = remap[buf[i + 0]];
+		const uint8 b = remap[buf[i + 1]];
+		const uint8 c = remap[buf[i + 2]];
+		const uint8 d = remap[buf[i + 3]];
+
+		buf[i + 0] = a;
+		buf[i + 1] = b;
+		buf[i + 2] = c;
+		buf[i + 3] = d;
+	}
+
+	for (; i < count; i++)
+		buf[i] = remap[buf[i]];
+}
+
+/**
+ * Apply a delta: xor the destination with the source.
+ *
+ * @param dst The destination.
+ * @param src The delta.
+ * @param count The number of pixels.
+ */
+void Blit_Xor(uint8* dst, const uint8* src, int count)
+{
+	int i = 0;
+
+#ifdef BLIT_SSE2
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, s));
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] ^= src[i];
+}
+
+/**
+ * Apply a delta of a single value: xor the destination with it.
+ *
+ * @param dst The destination.
+ * @param value The value to xor with.
+ * @param count The number of pixels.
+ */
+void Blit_XorFill(uint8* dst, uint8 value, int count)
+{
+	int i = 0;
+
+#ifdef BLIT_SSE2
+	const __m128i v = _mm_set1_epi8((char)value);
+
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, v));
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] ^= value;
+}
+
+/**
+ * Expand pixels to 32 bits through a palette.
+ *
+ * @param dst The 32-bit destination.
+ * @param src The 8-bit source.
+ * @param count The number of pixels.
+ * @param palette The 256 colours, in the format of the destination.
+ */
+void Blit_ExpandPalette(uint32* dst, const uint8* src, int count, const uint32* palette)
+{
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		dst[i + 0] = palette[src[i + 0]];
+		dst[i + 1] = palette[src[i + 1]];
+		dst[i + 2] = palette[src[i + 2]];
+		dst[i + 3] = palette[src[i + 3]];
+	}
+
+	for (; i < count; i++)
+		dst[i] = palette[src[i]];
+}
+
+/**
+ * Expand pixels to 32 bits through a palette, leaving the destination
+ *  untouched for pixels of colour 0.
+ *
+ * @param dst The 32-bit destination.
+ * @param src The 8-bit source.
+ * @param count The number of pixels.
+ * @param palette The 256 colours, in the format of the destination.
+ */
+void Blit_ExpandPaletteMasked(uint32* dst, const uint8* src, int count, const uint32* palette)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (src[i] != 0)
+			dst[i] = palette[src[i]];
+	}
+}
@@ -0,0 +1,15 @@
+/** @file src/video/blit.h Blitter definitions for 8-bit screens. */
+
+#ifndef VIDEO_BLIT_H
+#define VIDEO_BLIT_H
+
+#include "types.h"
+
+void Blit_CopyMasked(uint8* dst, const uint8* src, int count);
+void Blit_Remap(uint8* buf, int count, const uint8* remap);
+void Blit_Xor(uint8* dst, const uint8* src, int count);
+void Blit_XorFill(uint8* dst, uint8 value, int count);
+void Blit_ExpandPalette(uint32* dst, const uint8* src, int count, const uint32* palette);
+void Blit_ExpandPaletteMasked(uint32* dst, const uint8* src, int count, const uint32* palette);
+
+#endif /* VIDEO_BLIT_H */
@@ -45,6 +45,9 @@ void Video_ShowCursor();
 void Video_HideCursor();
 void Video_WarpCursor(int x, int y);
 void Video_ShadeScreen(int alpha);
+void Video_StoreBackground();
+bool Video_DrawBackground();
+void Video_InvalidateBackground();
 void Video_HoldBitmapDrawing(bool hold);
 
 void Video_DrawFadeIn(const struct FadeInAux* aux);
@@ -67,6 +70,7 @@ void Video_DrawMinimap(int left, int top, int map_scale, int mode);
 #define Video_DrawIcon          VideoA5_DrawIcon
 #define Video_DrawIconAlpha     VideoA5_DrawIconAlpha
 #define Video_DrawChar          VideoA5_DrawChar
+#define Video_DrawGlyphs        VideoA5_DrawGlyphs
 #define Video_DrawWSA           VideoA5_DrawWSA
 #define Video_DrawWSAStatic     VideoA5_DrawWSAStatic
 
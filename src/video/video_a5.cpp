@@ -49,6 +49,7 @@
 #include "../tools/random_lcg.h"
 #include "../wsa.h"
 
+#include "blit.h"
 #include "prim.h"
 
 #include "dune2_16x16.xpm"
@@ -140,6 +141,7 @@ static const struct
 };
 
 GraphicsDriver g_graphics_driver;
+bool g_palette_shader;
 
 /* Exposed for prim_a5.c. */
 ALLEGRO_COLOR paltoRGB[256];
@@ -161,6 +163,14 @@ static ALLEGRO_BITMAP* s_shape[SHAPEID_MAX][HOUSE_MAX];
 static ALLEGRO_BITMAP* s_font[FONTID_MAX][256];
 static ALLEGRO_MOUSE_CURSOR* s_cursor[CURSOR_MAX];
 
+static ALLEGRO_SHADER* s_palette_shader; /* palette lookup for 8-bit bitmaps. */
+static ALLEGRO_BITMAP* s_palette_texture; /* 256x1 palette sampled by s_palette_shader. */
+static ALLEGRO_BITMAP* s_indexed; /* 8-bit counterpart of scratch. */
+static bool s_palette_dirty;
+
+static ALLEGRO_BITMAP* s_background; /* copy of a screen that stays still behind an overlay. */
+static bool s_background_valid;
+
 static ALLEGRO_BITMAP* s_minimap;
 static int s_minimap_colour[MAP_SIZE_MAX * MAP_SIZE_MAX];
 
@@ -231,6 +241,24 @@ static void VideoA5_ResizeScratchBitmap(int w, int h)
 	}
 }
 
+static void VideoA5_ResizeIndexedBitmap(int w, int h)
+{
+	if ((s_indexed != NULL) && ((al_get_bitmap_width(s_indexed) != w) || (al_get_bitmap_height(s_indexed) != h)))
+	{
+		al_destroy_bitmap(s_indexed);
+		s_indexed = NULL;
+	}
+
+	if (s_indexed == NULL)
+	{
+		const int old_format = al_get_new_bitmap_format();
+
+		al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8);
+		s_indexed = al_create_bitmap(w, h);
+		al_set_new_bitmap_format(old_format);
+	}
+}
+
 static void VideoA5_ReadPalette(const char* filename)
 {
 	File_ReadBlockFile(filename, paletteRGB, 3 * 256);
@@ -243,6 +271,105 @@ static void VideoA5_ReadPalette(const char* filename)
 	paletteRGB[3 * WINDTRAP_COLOUR + 2] = 0x00;
 }
 
+/* VideoA5_InitPaletteShader:
+ *
+ * The palette shader draws 8-bit bitmaps by looking up each pixel in
+ * a 256x1 palette texture, so a palette change costs one small upload
+ * instead of expanding the whole image again.  Colour 0 is black, as
+ * with BLACK_COLOUR_0.
+ */
+static bool VideoA5_InitPaletteShader()
+{
+	static const char* glsl_pixel_source =
+		"#ifdef GL_ES\n"
+		"precision mediump float;\n"
+		"#endif\n"
+		"uniform sampler2D al_tex;\n"
+		"uniform sampler2D pal_tex;\n"
+		"varying vec4 varying_color;\n"
+		"varying vec2 varying_texcoord;\n"
+		"void main()\n"
+		"{\n"
+		"	float c = texture2D(al_tex, varying_texcoord).r;\n"
+		"	gl_FragColor = varying_color * texture2D(pal_tex, vec2((c * 255.0 + 0.5) / 256.0, 0.5));\n"
+		"}\n";
+
+	static const char* hlsl_pixel_source =
+		"texture al_tex;\n"
+		"sampler2D s = sampler_state {\n"
+		"	texture = <al_tex>;\n"
+		"	MinFilter = Point;\n"
+		"	MagFilter = Point;\n"
+		"};\n"
+		"texture pal_tex;\n"
+		"sampler2D p = sampler_state {\n"
+		"	texture = <pal_tex>;\n"
+		"	MinFilter = Point;\n"
+		"	MagFilter = Point;\n"
+		"};\n"
+		"float4 ps_main(VS_OUTPUT Input) : COLOR0\n"
+		"{\n"
+		"	float c = tex2D(s, Input.TexCoord).r;\n"
+		"	return Input.Color * tex2D(p, float2((c * 255.0 + 0.5) / 256.0, 0.5));\n"
+		"}\n";
+
+	const ALLEGRO_SHADER_PLATFORM platform = (g_graphics_driver == GRAPHICS_DRIVER_DIRECT3D) ? ALLEGRO_SHADER_HLSL : ALLEGRO_SHADER_GLSL;
+	const char* pixel_source = (platform == ALLEGRO_SHADER_HLSL) ? hlsl_pixel_source : glsl_pixel_source;
+
+	s_palette_shader = al_create_shader(platform);
+	if (s_palette_shader == NULL)
+		return false;
+
+	if (!al_attach_shader_source(s_palette_shader, ALLEGRO_VERTEX_SHADER, al_get_default_shader_source(platform, ALLEGRO_VERTEX_SHADER)) ||
+		!al_attach_shader_source(s_palette_shader, ALLEGRO_PIXEL_SHADER, pixel_source) ||
+		!al_build_shader(s_palette_shader))
+	{
+		Warning("Could not build the palette shader:\n%s\n", al_get_shader_log(s_palette_shader));
+		al_destroy_shader(s_palette_shader);
+		s_palette_shader = NULL;
+		return false;
+	}
+
+	s_palette_texture = al_create_bitmap(256, 1);
+	VideoA5_ResizeIndexedBitmap(SCREEN_WIDTH, SCREEN_HEIGHT);
+	if (s_palette_texture == NULL || s_indexed == NULL)
+	{
+		al_destroy_bitmap(s_palette_texture);
+		al_destroy_bitmap(s_indexed);
+		al_destroy_shader(s_palette_shader);
+		s_palette_texture = NULL;
+		s_indexed = NULL;
+		s_palette_shader = NULL;
+		return false;
+	}
+
+	s_palette_dirty = true;
+	return true;
+}
+
+static void VideoA5_UploadPalette()
+{
+	if (!s_palette_dirty)
+		return;
+
+	ALLEGRO_LOCKED_REGION* reg = al_lock_bitmap(s_palette_texture, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	if (reg == NULL)
+		return;
+
+	unsigned char* row = (unsigned char*)reg->data;
+
+	for (int c = 0; c < 256; c++)
+	{
+		row[4 * c + 0] = (c == 0) ? 0x00 : paletteRGB[3 * c + 0];
+		row[4 * c + 1] = (c == 0) ? 0x00 : paletteRGB[3 * c + 1];
+		row[4 * c + 2] = (c == 0) ? 0x00 : paletteRGB[3 * c + 2];
+		row[4 * c + 3] = 0xFF;
+	}
+
+	al_unlock_bitmap(s_palette_texture);
+	s_palette_dirty = false;
+}
+
 static ALLEGRO_BITMAP* VideoA5_InitDisplayIcon(char** xpm, int w, int h, int colours)
 {
 	struct
@@ -353,6 +480,11 @@ bool VideoA5_Init()
 		display_flags |= ALLEGRO_FULLSCREEN_WINDOW;
 	}
 
+	if (g_palette_shader)
+	{
+		display_flags |= ALLEGRO_PROGRAMMABLE_PIPELINE;
+	}
+
 	al_set_new_display_flags(display_flags);
 	al_set_new_display_option(ALLEGRO_VSYNC, 1, ALLEGRO_SUGGEST);
 	al_set_new_display_option(ALLEGRO_STENCIL_SIZE, 8, ALLEGRO_SUGGEST);
@@ -382,6 +514,9 @@ bool VideoA5_Init()
 	if (interface_texture == NULL || shape_texture == NULL || region_texture == NULL || s_minimap == NULL)
 		return false;
 
+	if (g_palette_shader && !VideoA5_InitPaletteShader())
+		Warning("Palette shader unavailable, expanding images on the CPU.\n");
+
 	al_register_event_source(g_a5_input_queue, al_get_display_event_source(display));
 
 	al_init_image_addon();
@@ -447,6 +582,17 @@ void VideoA5_Uninit()
 	al_destroy_bitmap(s_minimap);
 	s_minimap = NULL;
 
+	al_destroy_bitmap(s_background);
+	s_background = NULL;
+	s_background_valid = false;
+
+	al_destroy_bitmap(s_indexed);
+	al_destroy_bitmap(s_palette_texture);
+	al_destroy_shader(s_palette_shader);
+	s_indexed = NULL;
+	s_palette_texture = NULL;
+	s_palette_shader = NULL;
+
 	al_destroy_bitmap(interface_texture);
 	interface_texture = NULL;
 
@@ -505,6 +651,7 @@ void VideoA5_CaptureScreenshot()
 static void VideoA5_CopyBitmap(int src_stride, const unsigned char* raw, ALLEGRO_BITMAP* dest, BitmapCopyMode mode)
 {
 	ALLEGRO_LOCKED_REGION* reg;
+	uint32 palette[256];
 
 	if (mode == SKIP_COLOUR_0)
 		reg = al_lock_bitmap(dest, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READWRITE);
@@ -514,35 +661,29 @@ static void VideoA5_CopyBitmap(int src_stride, const unsigned char* raw, ALLEGRO
 	if (reg == NULL)
 		return;
 
+	/* Palette in the byte order of the bitmap: red, green, blue, alpha. */
+	for (int c = 0; c < 256; c++)
+	{
+		unsigned char rgba[4];
+
+		rgba[0] = (c == 0) ? 0x00 : paletteRGB[3 * c + 0];
+		rgba[1] = (c == 0) ? 0x00 : paletteRGB[3 * c + 1];
+		rgba[2] = (c == 0) ? 0x00 : paletteRGB[3 * c + 2];
+		rgba[3] = (c == 0 && mode == TRANSPARENT_COLOUR_0) ? 0x00 : 0xFF;
+		memcpy(&palette[c], rgba, sizeof(rgba));
+	}
+
 	const int w = al_get_bitmap_width(dest);
 	const int h = al_get_bitmap_height(dest);
 
 	for (int y = 0; y < h; y++)
 	{
-		unsigned char* row = &((unsigned char *)reg->data)[reg->pitch * y];
-
-		for (int x = 0; x < w; x++)
-		{
-			const unsigned char c = raw[src_stride * y + x];
+		uint32* row = (uint32*)&((unsigned char *)reg->data)[reg->pitch * y];
 
-			if (c == 0)
-			{
-				if (mode != SKIP_COLOUR_0)
-				{
-					row[reg->pixel_size * x + 0] = 0x00;
-					row[reg->pixel_size * x + 1] = 0x00;
-					row[reg->pixel_size * x + 2] = 0x00;
-					row[reg->pixel_size * x + 3] = (mode == TRANSPARENT_COLOUR_0) ? 0x00 : 0xFF;
-				}
-			}
-			else
-			{
-				row[reg->pixel_size * x + 0] = paletteRGB[3 * c + 0];
-				row[reg->pixel_size * x + 1] = paletteRGB[3 * c + 1];
-				row[reg->pixel_size * x + 2] = paletteRGB[3 * c + 2];
-				row[reg->pixel_size * x + 3] = 0xFF;
-			}
-		}
+		if (mode == SKIP_COLOUR_0)
+			Blit_ExpandPaletteMasked(row, &raw[src_stride * y], w, palette);
+		else
+			Blit_ExpandPalette(row, &raw[src_stride * y], w, palette);
 	}
 
 	al_unlock_bitmap(dest);
@@ -663,6 +804,8 @@ void Video_SetPalette(const uint8* palette, int from, int length)
 		paletteRGB[3 * i + 1] = g;
 		paletteRGB[3 * i + 2] = b;
 	}
+
+	s_palette_dirty = true;
 }
 
 void Video_SetClippingArea(int x, int y, int w, int h)
@@ -705,6 +848,60 @@ void Video_ShadeScreen(int alpha)
 	A5_UseTransform(prev_transform);
 }
 
+/* Video_StoreBackground:
+ *
+ * Keep a copy of the back buffer, so a paused screen behind an overlay
+ * can be put back with one blit instead of drawing it all again.
+ */
+void Video_StoreBackground()
+{
+	ALLEGRO_BITMAP* backbuffer = al_get_backbuffer(display);
+	const ScreenDivID prev_transform = A5_SaveTransform();
+
+	if ((s_background != NULL) && ((al_get_bitmap_width(s_background) != TRUE_DISPLAY_WIDTH) || (al_get_bitmap_height(s_background) != TRUE_DISPLAY_HEIGHT)))
+	{
+		al_destroy_bitmap(s_background);
+		s_background = NULL;
+	}
+
+	if (s_background == NULL)
+		s_background = al_create_bitmap(TRUE_DISPLAY_WIDTH, TRUE_DISPLAY_HEIGHT);
+
+	if (s_background == NULL)
+		return;
+
+	al_set_target_bitmap(s_background);
+	al_draw_bitmap(backbuffer, 0.0f, 0.0f, 0);
+	A5_UseTransform(prev_transform);
+
+	s_background_valid = true;
+}
+
+bool Video_DrawBackground()
+{
+	if (!s_background_valid)
+		return false;
+
+	if ((al_get_bitmap_width(s_background) != TRUE_DISPLAY_WIDTH) || (al_get_bitmap_height(s_background) != TRUE_DISPLAY_HEIGHT))
+	{
+		s_background_valid = false;
+		return false;
+	}
+
+	const ScreenDivID prev_transform = A5_SaveTransform();
+
+	A5_UseTransform(SCREENDIV_MAIN);
+	al_draw_bitmap(s_background, 0.0f, 0.0f, 0);
+	A5_UseTransform(prev_transform);
+
+	return true;
+}
+
+void Video_InvalidateBackground()
+{
+	s_background_valid = false;
+}
+
 void Video_HoldBitmapDrawing(bool hold)
 {
 	al_hold_bitmap_drawing(hold);
@@ -2404,6 +2601,24 @@ void VideoA5_DrawChar(unsigned char c, const uint8* pal, int x, int y)
 		al_draw_tinted_bitmap(s_font[fnt][c], fg, x, y, 0);
 }
 
+void VideoA5_DrawGlyphs(const uint8* chars, const int16* x, const int16* y, int count, const uint8* pal)
+{
+	const int fnt = VideoA5_FontIndex(g_fontCurrent, pal);
+	const ALLEGRO_COLOR fg = paltoRGB[pal[1]];
+	const bool held = al_is_bitmap_drawing_held();
+
+	/* All glyphs are in interface_texture, so this is one batch. */
+	al_hold_bitmap_drawing(true);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (s_font[fnt][chars[i]] != NULL)
+			al_draw_tinted_bitmap(s_font[fnt][chars[i]], fg, x[i], y[i], 0);
+	}
+
+	al_hold_bitmap_drawing(held);
+}
+
 /*--------------------------------------------------------------*/
 
 static void VideoA5_InitWSA(unsigned char* buf)
@@ -2438,12 +2653,36 @@ static void VideoA5_InitWSA(unsigned char* buf)
 	WSA_Unload(wsa);
 }
 
-bool VideoA5_DrawWSA(void* wsa, int frame, int sx, int sy, int dx, int dy, int w, int h)
+/**
+ * Draw 8 bit pixels through the palette shader.
+ *
+ * @return False if the indexed bitmap could not be created or locked.
+ */
+static bool VideoA5_DrawIndexed(int src_stride, const unsigned char* raw, int dx, int dy, int w, int h)
 {
-	VideoA5_ResizeScratchBitmap(w, h);
-	if (scratch == NULL)
+	VideoA5_ResizeIndexedBitmap(w, h);
+	if (s_indexed == NULL)
+		return false;
+
+	ALLEGRO_LOCKED_REGION* reg = al_lock_bitmap(s_indexed, ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8, ALLEGRO_LOCK_WRITEONLY);
+	if (reg == NULL)
 		return false;
 
+	for (int y = 0; y < h; y++)
+		memcpy(&((unsigned char *)reg->data)[reg->pitch * y], &raw[src_stride * y], w);
+
+	al_unlock_bitmap(s_indexed);
+	VideoA5_UploadPalette();
+
+	al_use_shader(s_palette_shader);
+	al_set_shader_sampler("pal_tex", s_palette_texture, 1);
+	al_draw_bitmap(s_indexed, dx, dy, 0);
+	al_use_shader(NULL);
+	return true;
+}
+
+bool VideoA5_DrawWSA(void* wsa, int frame, int sx, int sy, int dx, int dy, int w, int h)
+{
 	if (wsa != NULL)
 	{
 		if (!WSA_DisplayFrame(wsa, frame, 0, 0, SCREEN_0))
@@ -2452,6 +2691,14 @@ bool VideoA5_DrawWSA(void* wsa, int frame, int sx, int sy, int dx, int dy, int w
 
 	const unsigned char* buf = (const unsigned char*)GFX_Screen_Get_ByIndex(SCREEN_0);
 
+	/* Without the shader, or if the indexed bitmap is not available, convert the pixels instead. */
+	if (s_palette_shader != NULL && VideoA5_DrawIndexed(SCREEN_WIDTH, &buf[SCREEN_WIDTH * sy + sx], dx, dy, w, h))
+		return true;
+
+	VideoA5_ResizeScratchBitmap(w, h);
+	if (scratch == NULL)
+		return false;
+
 	VideoA5_CopyBitmap(SCREEN_WIDTH, &buf[SCREEN_WIDTH * sy + sx], scratch, BLACK_COLOUR_0);
 	al_draw_bitmap(scratch, dx, dy, 0);
 
@@ -2730,5 +2977,7 @@ void VideoA5_DisplayFound()
 	al_destroy_bitmap(scratch);
 	scratch = NULL;
 
+	s_background_valid = false;
+
 	memset(s_minimap_colour, 0, sizeof(s_minimap_colour));
 }
@@ -11,6 +11,7 @@ enum GraphicsDriver
 };
 
 extern GraphicsDriver g_graphics_driver;
+extern bool g_palette_shader;
 
 bool VideoA5_Init();
 void VideoA5_Uninit();
@@ -35,6 +36,7 @@ void VideoA5_DrawShapeGrey(ShapeID shapeID, int x, int y, int flags);
 void VideoA5_DrawShapeGreyScale(ShapeID shapeID, int x, int y, int w, int h, int flags);
 void VideoA5_DrawShapeTint(ShapeID shapeID, int x, int y, unsigned char c, int flags);
 void VideoA5_DrawChar(unsigned char c, const uint8* pal, int x, int y);
+void VideoA5_DrawGlyphs(const uint8* chars, const int16* x, const int16* y, int count, const uint8* pal);
 bool VideoA5_DrawWSA(void* wsa, int frame, int sx, int sy, int dx, int dy, int w, int h);
 void VideoA5_DrawWSAStatic(int frame, int x, int y);
 